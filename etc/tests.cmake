@@ -23,6 +23,7 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_write_to)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -58,6 +59,17 @@ ttest(net_interface)
 
 ttest(router)
 
+ttest(header_codec)
+
+ttest(arp_cache)
+
+ttest(ip_fragments)
+
+ttest(checksum_kernels)
+
+ttest(udp_batch)
+ttest(buffer_pool_read)
+
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
 add_custom_target (check_webget COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 12 -R 'webget')
@@ -90,3 +102,5 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(checksum_speed_test)
+stest(lpm_speed_test)
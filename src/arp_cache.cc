@@ -0,0 +1,124 @@
+#include "arp_cache.hh"
+
+#include <utility>
+
+using namespace std;
+
+ARPCache::ARPCache( const uint64_t lifetime_ms ) : lifetime_ms_( lifetime_ms ), slots_( 16 ), wheel_( WHEEL_SLOTS )
+{}
+
+size_t ARPCache::home( const uint32_t ip_address ) const
+{
+  // Fibonacci hashing: neighbouring addresses land far apart
+  const uint64_t hash = static_cast<uint64_t>( ip_address ) * 0x9e3779b97f4a7c15ULL;
+  return ( hash >> 32 ) & ( slots_.size() - 1 );
+}
+
+size_t ARPCache::index_of( const uint32_t ip_address ) const
+{
+  for ( size_t i = home( ip_address );; i = ( i + 1 ) & ( slots_.size() - 1 ) ) {
+    if ( not slots_[i].occupied ) {
+      return NOT_FOUND;
+    }
+    if ( slots_[i].ip_address == ip_address ) {
+      return i;
+    }
+  }
+}
+
+const ARPCache::Entry* ARPCache::find( const uint32_t ip_address ) const
+{
+  const size_t index = index_of( ip_address );
+  return index == NOT_FOUND ? nullptr : &slots_[index].entry;
+}
+
+ARPCache::Entry* ARPCache::find( const uint32_t ip_address )
+{
+  const size_t index = index_of( ip_address );
+  return index == NOT_FOUND ? nullptr : &slots_[index].entry;
+}
+
+ARPCache::Entry& ARPCache::learn( const uint32_t ip_address,
+                                  const EthernetAddress& ethernet_address,
+                                  const uint64_t now )
+{
+  size_t index = index_of( ip_address );
+  if ( index == NOT_FOUND ) {
+    if ( 2 * ( size_ + 1 ) > slots_.size() ) {
+      grow();
+    }
+    for ( index = home( ip_address ); slots_[index].occupied; index = ( index + 1 ) & ( slots_.size() - 1 ) ) {}
+    slots_[index].occupied = true;
+    slots_[index].ip_address = ip_address;
+    ++size_;
+  }
+
+  Entry& entry = slots_[index].entry;
+  if ( entry.ethernet_address != ethernet_address ) {
+    entry.ethernet_address = ethernet_address;
+    entry.ethernet_header = {};
+  }
+  entry.expires_at = now + lifetime_ms_;
+  entry.refresh_requested = false;
+  wheel_[( entry.expires_at / WHEEL_SLOT_MS ) % WHEEL_SLOTS].push_back( { ip_address, entry.expires_at } );
+  return entry;
+}
+
+void ARPCache::expire( const uint64_t now )
+{
+  // Visit each wheel slot from the first unfinished one up to the current one (at most one
+  // full turn). Items not yet due, because they belong to a later turn or to the later part
+  // of the current slot, stay where they are.
+  const uint64_t current = now / WHEEL_SLOT_MS;
+  const uint64_t first = current - next_wheel_slot_ >= WHEEL_SLOTS ? current - WHEEL_SLOTS + 1 : next_wheel_slot_;
+
+  for ( uint64_t slot_num = first; slot_num <= current; ++slot_num ) {
+    auto& deadlines = wheel_[slot_num % WHEEL_SLOTS];
+    erase_if( deadlines, [&]( const Deadline& deadline ) {
+      if ( deadline.expires_at > now ) {
+        return false;
+      }
+      // only expire the mapping if it was not re-learned since this deadline was filed
+      const size_t index = index_of( deadline.ip_address );
+      if ( index != NOT_FOUND and slots_[index].entry.expires_at == deadline.expires_at ) {
+        erase( index );
+      }
+      return true;
+    } );
+  }
+  next_wheel_slot_ = current; // the current slot may still hold items due later in it
+}
+
+// Remove a mapping, shifting later members of its probe run back so lookups stay correct
+// without tombstones
+void ARPCache::erase( size_t index )
+{
+  const size_t mask = slots_.size() - 1;
+  slots_[index] = Slot {};
+  --size_;
+
+  for ( size_t next = ( index + 1 ) & mask; slots_[next].occupied; next = ( next + 1 ) & mask ) {
+    // move the slot back into the hole unless its home lies cyclically in (index, next]
+    const size_t home_slot = home( slots_[next].ip_address );
+    const bool stays = index <= next ? ( index < home_slot and home_slot <= next )
+                                     : ( index < home_slot or home_slot <= next );
+    if ( not stays ) {
+      slots_[index] = std::exchange( slots_[next], Slot {} );
+      index = next;
+    }
+  }
+}
+
+void ARPCache::grow()
+{
+  vector<Slot> old = std::exchange( slots_, vector<Slot>( slots_.size() * 2 ) );
+  for ( const auto& slot : old ) {
+    if ( slot.occupied ) {
+      size_t index = home( slot.ip_address );
+      while ( slots_[index].occupied ) {
+        index = ( index + 1 ) & ( slots_.size() - 1 );
+      }
+      slots_[index] = slot;
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "buffer.hh"
+#include "ethernet_header.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The IP-to-Ethernet mappings a NetworkInterface has learned, each valid for a fixed time.
+//
+// Mappings live in an open-addressing hash table (linear probing, kept at most half full),
+// so finding one is usually a single probe. Expiry is driven by a hashed timing wheel:
+// each mapping's deadline is filed in the wheel slot for that time, and advancing the
+// clock only visits the slots that have come due. Deadlines are checked exactly and a
+// mapping that was re-learned (getting a later deadline) simply leaves a stale wheel
+// item behind, which is discarded when its slot comes up.
+class ARPCache
+{
+public:
+  struct Entry
+  {
+    EthernetAddress ethernet_address {};
+    uint64_t expires_at {}; // in ms; the mapping is gone once the time reaches this
+
+    // For the owner: the serialized Ethernet header of frames to this neighbor (empty if not made yet)
+    Buffer ethernet_header {};
+
+    // For the owner: a request to refresh this mapping before it expires has been sent
+    bool refresh_requested {};
+  };
+
+  explicit ARPCache( uint64_t lifetime_ms = 30000 );
+
+  // The mapping for `ip_address`, or nullptr if there is none
+  const Entry* find( uint32_t ip_address ) const;
+  Entry* find( uint32_t ip_address );
+
+  // Record (or refresh) a mapping at time `now`. The entry's ethernet_header is cleared
+  // if the Ethernet address changed, and refresh_requested is cleared.
+  Entry& learn( uint32_t ip_address, const EthernetAddress& ethernet_address, uint64_t now );
+
+  // Advance the clock to `now`, dropping every mapping that has expired
+  void expire( uint64_t now );
+
+  size_t size() const { return size_; }
+
+private:
+  struct Slot
+  {
+    uint32_t ip_address {};
+    bool occupied {};
+    Entry entry {};
+  };
+
+  struct Deadline
+  {
+    uint32_t ip_address {};
+    uint64_t expires_at {};
+  };
+
+  static constexpr uint64_t WHEEL_SLOT_MS = 1024;
+  static constexpr size_t WHEEL_SLOTS = 64; // one turn of the wheel spans about 65 s
+
+  uint64_t lifetime_ms_;
+  std::vector<Slot> slots_;
+  size_t size_ {};
+
+  std::vector<std::vector<Deadline>> wheel_;
+  uint64_t next_wheel_slot_ {}; // absolute number of the first wheel slot not yet fully processed
+
+  static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+  size_t home( uint32_t ip_address ) const;
+  size_t index_of( uint32_t ip_address ) const; // slot holding the mapping, or NOT_FOUND
+  void erase( size_t index );
+  void grow();
+};
@@ -7,6 +7,7 @@
 
 class Reader;
 class Writer;
+class FileDescriptor;
 
 class ByteStream
 {
@@ -59,3 +60,11 @@ public:
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out );
+
+/*
+ * write_to: A helper function that writes as much of a ByteStream Reader's
+ * buffered data as `fd` will accept, directly from the stream's buffer (no
+ * intermediate string), and pops exactly the bytes that were written.
+ * Returns the number of bytes written.
+ */
+uint64_t write_to( Reader& reader, FileDescriptor& fd );
@@ -1,4 +1,5 @@
 #include "byte_stream.hh"
+#include "file_descriptor.hh"
 
 #include <cstdint>
 #include <stdexcept>
@@ -24,6 +25,22 @@ void read( Reader& reader, uint64_t len, std::string& out )
   }
 }
 
+/*
+ * write_to: A helper function that hands the Reader's buffered bytes to the
+ * kernel in place (via writev), then pops only the bytes that were accepted.
+ */
+uint64_t write_to( Reader& reader, FileDescriptor& fd )
+{
+  const std::string_view view = reader.peek();
+  if ( view.empty() ) {
+    return 0;
+  }
+
+  const uint64_t written = fd.write( view );
+  reader.pop( written );
+  return written;
+}
+
 Reader& ByteStream::reader()
 {
   static_assert( sizeof( Reader ) == sizeof( ByteStream ),
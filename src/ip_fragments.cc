@@ -0,0 +1,172 @@
+#include "ip_fragments.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Largest payload a datagram can carry (the total length field is 16 bits)
+constexpr size_t MAX_PAYLOAD = UINT16_MAX - IPv4Header::LENGTH;
+
+// Fragment offsets count 8-byte units
+constexpr size_t FRAGMENT_UNIT = 8;
+
+} // namespace
+
+bool fragment_datagram( InternetDatagram&& dgram, const size_t mtu, vector<InternetDatagram>& out )
+{
+  if ( dgram.header.len <= mtu ) {
+    out.push_back( std::move( dgram ) );
+    return true;
+  }
+
+  // every fragment but the last carries a multiple of 8 bytes
+  const size_t per_fragment = mtu > IPv4Header::LENGTH ? ( mtu - IPv4Header::LENGTH ) & ~( FRAGMENT_UNIT - 1 ) : 0;
+  if ( dgram.header.df or per_fragment == 0 ) {
+    return false;
+  }
+
+  // the header says how much payload there is: refuse a datagram whose Buffers disagree, rather
+  // than send fragments of a different datagram (or none at all)
+  const size_t header_length = size_t { dgram.header.hlen } * 4;
+  const size_t total = dgram.header.len > header_length ? dgram.header.len - header_length : 0;
+  size_t payload_length = 0;
+  for ( const auto& buf : dgram.payload ) {
+    payload_length += buf.size();
+  }
+  if ( total == 0 or payload_length != total ) {
+    return false;
+  }
+
+  IPv4Header header = dgram.header;
+  header.hlen = IPv4Header::LENGTH / 4; // options are not carried
+  const size_t base_offset = size_t { dgram.header.offset } * FRAGMENT_UNIT; // if `dgram` is itself a fragment
+
+  auto piece = dgram.payload.begin();
+  size_t piece_offset = 0; // bytes of *piece already used
+  for ( size_t position = 0; position < total; ) {
+    const size_t length = min( per_fragment, total - position );
+
+    InternetDatagram fragment;
+    fragment.header = header;
+    fragment.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + length );
+    fragment.header.offset = static_cast<uint16_t>( ( base_offset + position ) / FRAGMENT_UNIT );
+    fragment.header.mf = position + length < total or dgram.header.mf;
+    fragment.header.compute_checksum();
+
+    for ( size_t needed = length; needed > 0; ) {
+      const size_t take = min( needed, piece->size() - piece_offset );
+      fragment.payload.push_back( piece->substr( piece_offset, take ) );
+      needed -= take;
+      piece_offset += take;
+      if ( piece_offset == piece->size() ) {
+        ++piece;
+        piece_offset = 0;
+      }
+    }
+
+    out.push_back( std::move( fragment ) );
+    position += length;
+  }
+  return true;
+}
+
+size_t DatagramReassembler::KeyHash::operator()( const Key& key ) const
+{
+  const uint64_t mixed = ( uint64_t { key.src } << 32 | key.dst ) ^ ( uint64_t { key.id } << 8 | key.proto );
+  return static_cast<size_t>( mixed * 0x9E3779B97F4A7C15 );
+}
+
+DatagramReassembler::Bucket::Bucket() : stream( MAX_PAYLOAD ) {}
+
+DatagramReassembler::DatagramReassembler( const Config& config ) : config_( config ) {}
+
+optional<InternetDatagram> DatagramReassembler::receive( InternetDatagram&& dgram )
+{
+  IPv4Header& header = dgram.header;
+  if ( not header.mf and header.offset == 0 ) {
+    return std::move( dgram ); // not a fragment
+  }
+
+  string data;
+  for ( const auto& buf : dgram.payload ) {
+    data.append( buf );
+  }
+  const size_t first_index = size_t { header.offset } * FRAGMENT_UNIT;
+  if ( first_index + data.size() > MAX_PAYLOAD or ( header.mf and data.size() % FRAGMENT_UNIT != 0 ) ) {
+    ++fragments_dropped_;
+    return nullopt;
+  }
+
+  const Key key { header.src, header.dst, header.id, header.proto };
+  auto bucket = buckets_.find( key );
+  if ( bucket == buckets_.end() ) {
+    if ( buckets_.size() >= config_.max_datagrams ) {
+      evict_oldest();
+    }
+    bucket = buckets_.try_emplace( key ).first;
+    bucket->second.started_at = time_;
+  }
+
+  Bucket& b = bucket->second;
+  if ( header.offset == 0 ) {
+    b.first_header = header;
+  }
+  b.reassembler.insert( first_index, std::move( data ), not header.mf, b.stream.writer() );
+
+  const size_t held = b.reassembler.bytes_pending() + b.stream.reader().bytes_buffered();
+  bytes_held_ = bytes_held_ - b.bytes_held + held;
+  b.bytes_held = held;
+
+  if ( b.stream.writer().is_closed() and b.first_header.has_value() ) {
+    InternetDatagram whole;
+    whole.header = *b.first_header;
+    whole.header.hlen = IPv4Header::LENGTH / 4;
+    whole.header.mf = false;
+    whole.header.offset = 0;
+    whole.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + b.stream.reader().bytes_buffered() );
+    whole.header.compute_checksum();
+
+    string payload;
+    read( b.stream.reader(), b.stream.reader().bytes_buffered(), payload );
+    whole.payload.emplace_back( std::move( payload ) );
+
+    bytes_held_ -= b.bytes_held;
+    buckets_.erase( bucket );
+    return whole;
+  }
+
+  while ( bytes_held_ > config_.max_bytes and not buckets_.empty() ) {
+    evict_oldest();
+  }
+  return nullopt;
+}
+
+void DatagramReassembler::tick( const uint64_t ms_since_last_tick )
+{
+  time_ += ms_since_last_tick;
+  for ( auto it = buckets_.begin(); it != buckets_.end(); ) {
+    if ( it->second.started_at + config_.timeout_ms <= time_ ) {
+      drop( it++ );
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DatagramReassembler::drop( const Buckets::iterator bucket )
+{
+  bytes_held_ -= bucket->second.bytes_held;
+  ++datagrams_dropped_;
+  buckets_.erase( bucket );
+}
+
+void DatagramReassembler::evict_oldest()
+{
+  const auto oldest = ranges::min_element(
+    buckets_, []( const auto& a, const auto& b ) { return a.second.started_at < b.second.started_at; } );
+  if ( oldest != buckets_.end() ) {
+    drop( oldest );
+  }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "byte_stream.hh"
+#include "ipv4_datagram.hh"
+#include "reassembler.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Split `dgram` into fragments of at most `mtu` bytes (header included) and append them to `out`.
+// The fragments' payloads are slices of the datagram's own Buffers (nothing is copied), and a
+// datagram that already fits is appended as it is. Returns false, appending nothing, if the
+// datagram does not fit but has DF set, if the MTU leaves no room for a fragment's payload, or
+// if its payload is not as long as its header says.
+bool fragment_datagram( InternetDatagram&& dgram, size_t mtu, std::vector<InternetDatagram>& out );
+
+// Puts fragmented IPv4 datagrams back together.
+//
+// Fragments are collected per (src, dst, id, proto). Each bucket feeds the fragments'
+// payloads to a Reassembler (indexed by byte offset) writing into a ByteStream, so
+// out-of-order, duplicate and overlapping fragments are handled as for TCP segments;
+// the datagram is complete when the Reassembler closes the stream. A bucket that is not
+// completed within the timeout is dropped, as is the oldest bucket whenever the bytes
+// held or the number of buckets would exceed its limit.
+class DatagramReassembler
+{
+public:
+  struct Config
+  {
+    size_t max_bytes { 4 << 20 };   // payload bytes held across all incomplete datagrams
+    size_t max_datagrams { 1024 };  // incomplete datagrams held at once
+    uint64_t timeout_ms { 30000 };  // from a datagram's first fragment
+  };
+
+  explicit DatagramReassembler( const Config& config );
+  DatagramReassembler() : DatagramReassembler( Config {} ) {}
+
+  // Unfragmented datagrams come straight back. A fragment comes back as the whole datagram
+  // once it completes one, and otherwise nothing does.
+  std::optional<InternetDatagram> receive( InternetDatagram&& dgram );
+
+  // Time has passed: drop incomplete datagrams whose time is up
+  void tick( uint64_t ms_since_last_tick );
+
+  size_t datagrams_pending() const { return buckets_.size(); }
+  size_t bytes_pending() const { return bytes_held_; }
+  uint64_t fragments_dropped() const { return fragments_dropped_; } // malformed fragments
+  uint64_t datagrams_dropped() const { return datagrams_dropped_; } // timed out or evicted
+
+private:
+  struct Key
+  {
+    uint32_t src {};
+    uint32_t dst {};
+    uint16_t id {};
+    uint8_t proto {};
+
+    bool operator==( const Key& other ) const = default;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()( const Key& key ) const;
+  };
+
+  struct Bucket
+  {
+    ByteStream stream;
+    Reassembler reassembler {};
+    std::optional<IPv4Header> first_header {}; // from the fragment at offset 0
+    uint64_t started_at {};
+    size_t bytes_held {};
+
+    Bucket();
+  };
+
+  using Buckets = std::unordered_map<Key, Bucket, KeyHash>;
+
+  Config config_;
+  Buckets buckets_ {};
+  uint64_t time_ {};
+  size_t bytes_held_ {};
+  uint64_t fragments_dropped_ {};
+  uint64_t datagrams_dropped_ {};
+
+  void drop( Buckets::iterator bucket );
+  void evict_oldest();
+};
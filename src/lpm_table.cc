@@ -0,0 +1,116 @@
+#include "lpm_table.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+LPMTable::LPMTable() : level1_( 1 << 16 ) {}
+
+void LPMTable::insert( uint32_t prefix, const uint8_t prefix_length, const uint32_t value )
+{
+  if ( prefix_length > 32 ) {
+    throw runtime_error( "LPMTable: prefix length must be at most 32" );
+  }
+  if ( value > MAX_VALUE ) {
+    throw runtime_error( "LPMTable: value out of range" );
+  }
+
+  prefix &= mask( prefix_length );
+  routes_[prefix_length][prefix] = value;
+
+  // overwrite every entry whose route is no more specific than this one
+  const uint32_t leaf = make_leaf( prefix_length, value );
+  for_each_leaf( prefix, prefix_length, [&]( uint32_t& entry ) {
+    if ( leaf_length( entry ) <= prefix_length ) {
+      entry = leaf;
+    }
+  } );
+}
+
+bool LPMTable::erase( uint32_t prefix, const uint8_t prefix_length )
+{
+  if ( prefix_length > 32 ) {
+    return false;
+  }
+
+  prefix &= mask( prefix_length );
+  if ( routes_[prefix_length].erase( prefix ) == 0 ) {
+    return false;
+  }
+
+  // the entries this route owned now belong to the longest shorter route covering it, if any
+  uint32_t replacement = 0;
+  for ( int length = prefix_length - 1; length >= 0; --length ) {
+    const auto& routes = routes_[length];
+    const auto it = routes.find( prefix & mask( length ) );
+    if ( it != routes.end() ) {
+      replacement = make_leaf( length, it->second );
+      break;
+    }
+  }
+
+  // only an entry written by this very prefix has its length within its range
+  for_each_leaf( prefix, prefix_length, [&]( uint32_t& entry ) {
+    if ( leaf_length( entry ) == prefix_length and ( entry & VALUE_MASK ) != 0 ) {
+      entry = replacement;
+    }
+  } );
+  return true;
+}
+
+size_t LPMTable::size() const
+{
+  size_t total = 0;
+  for ( const auto& routes : routes_ ) {
+    total += routes.size();
+  }
+  return total;
+}
+
+template<class Rewrite>
+void LPMTable::for_each_leaf( const uint32_t prefix, const uint8_t prefix_length, Rewrite&& rewrite )
+{
+  if ( prefix_length <= 16 ) {
+    rewrite_range( level1_, prefix >> 16, size_t { 1 } << ( 16 - prefix_length ), rewrite );
+    return;
+  }
+
+  const size_t level2 = child_of( level1_, prefix >> 16 ) * CHUNK_SIZE;
+  if ( prefix_length <= 24 ) {
+    rewrite_range( chunks_, level2 + ( ( prefix >> 8 ) & 0xff ), size_t { 1 } << ( 24 - prefix_length ), rewrite );
+    return;
+  }
+
+  const size_t level3 = child_of( chunks_, level2 + ( ( prefix >> 8 ) & 0xff ) ) * CHUNK_SIZE;
+  rewrite_range( chunks_, level3 + ( prefix & 0xff ), size_t { 1 } << ( 32 - prefix_length ), rewrite );
+}
+
+uint32_t LPMTable::child_of( vector<uint32_t>& level, const size_t index )
+{
+  const uint32_t entry = level[index];
+  if ( entry & CHILD ) {
+    return entry & INDEX_MASK;
+  }
+
+  // the new chunk starts out answering exactly as the leaf it replaces
+  const auto chunk = static_cast<uint32_t>( chunks_.size() / CHUNK_SIZE );
+  if ( chunk > INDEX_MASK ) {
+    throw runtime_error( "LPMTable: out of chunks" );
+  }
+  chunks_.resize( chunks_.size() + CHUNK_SIZE, entry ); // may move chunks_, so `level` is indexed afresh below
+  level[index] = CHILD | chunk;
+  return chunk;
+}
+
+template<class Rewrite>
+void LPMTable::rewrite_range( vector<uint32_t>& level, const size_t first, const size_t count, Rewrite&& rewrite )
+{
+  for ( size_t i = first; i < first + count; ++i ) {
+    const uint32_t entry = level[i];
+    if ( entry & CHILD ) {
+      rewrite_range( chunks_, ( entry & INDEX_MASK ) * CHUNK_SIZE, CHUNK_SIZE, rewrite );
+    } else {
+      rewrite( level[i] );
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// A longest-prefix-match table for IPv4 addresses, mapping each prefix to a small integer
+// (e.g. an index into a table of next hops).
+//
+// The table is a fixed-stride multibit trie with 16-, 8- and 8-bit levels ("DIR-16-8-8"):
+// a lookup reads one entry from a 65,536-entry first level and, only for destinations
+// covered by a prefix longer than /16 (or /24), one more entry from a 256-entry chunk
+// per extra level. Each entry is a single 32-bit word that either holds the answer or
+// points to a chunk, so a lookup is at most three dependent loads with no comparisons
+// against the routes themselves.
+//
+// Prefixes are expanded into every entry they cover. Each leaf entry remembers the
+// length of the prefix that wrote it, so a longer prefix is never overwritten by a
+// shorter one, whatever order routes are inserted in, and erasing a prefix only
+// rewrites the entries it owns (with the next-longest covering route). Neither needs
+// a rebuild.
+class LPMTable
+{
+public:
+  static constexpr uint32_t NO_ROUTE = UINT32_MAX;        // lookup() result when no prefix matches
+  static constexpr uint32_t MAX_VALUE = ( 1U << 24 ) - 2; // largest value a route can map to
+
+  LPMTable();
+
+  // Map `prefix_length` high-order bits of `prefix` to `value`, replacing any
+  // value previously stored for the same prefix
+  void insert( uint32_t prefix, uint8_t prefix_length, uint32_t value );
+
+  // Remove the route for exactly this prefix; returns false if there was none
+  bool erase( uint32_t prefix, uint8_t prefix_length );
+
+  // Number of routes in the table
+  size_t size() const;
+
+  // The value of the longest prefix matching `address`, or NO_ROUTE
+  uint32_t lookup( const uint32_t address ) const
+  {
+    uint32_t entry = level1_[address >> 16];
+    if ( entry & CHILD ) {
+      entry = chunks_[( entry & INDEX_MASK ) * CHUNK_SIZE + ( ( address >> 8 ) & 0xff )];
+      if ( entry & CHILD ) {
+        entry = chunks_[( entry & INDEX_MASK ) * CHUNK_SIZE + ( address & 0xff )];
+      }
+    }
+    return ( entry & VALUE_MASK ) - 1; // a leaf with no route stores 0, which wraps to NO_ROUTE
+  }
+
+  // Bytes used by the lookup structure
+  size_t memory_usage() const { return ( level1_.size() + chunks_.size() ) * sizeof( uint32_t ); }
+
+private:
+  // Entry layout: [31] child flag | [29:24] prefix length of a leaf | [23:0] leaf value + 1, or chunk index
+  static constexpr uint32_t CHILD = 1U << 31;
+  static constexpr uint32_t VALUE_MASK = ( 1U << 24 ) - 1;
+  static constexpr uint32_t INDEX_MASK = VALUE_MASK;
+  static constexpr size_t CHUNK_SIZE = 256;
+
+  static uint32_t make_leaf( uint8_t prefix_length, uint32_t value ) { return prefix_length << 24 | ( value + 1 ); }
+  static uint8_t leaf_length( uint32_t entry ) { return ( entry >> 24 ) & 0x3f; }
+
+  std::vector<uint32_t> level1_;    // indexed by the top 16 bits of the address
+  std::vector<uint32_t> chunks_ {}; // second- and third-level chunks of CHUNK_SIZE entries
+
+  // The routes themselves, by prefix length (used to find what an erased prefix uncovers)
+  std::array<std::unordered_map<uint32_t, uint32_t>, 33> routes_ {};
+
+  static uint32_t mask( uint8_t prefix_length )
+  {
+    return prefix_length == 0 ? 0 : UINT32_MAX << ( 32 - prefix_length );
+  }
+
+  // Call `rewrite` on the leaf entries covered by the prefix, creating chunks as needed
+  template<class Rewrite>
+  void for_each_leaf( uint32_t prefix, uint8_t prefix_length, Rewrite&& rewrite );
+
+  // The chunk below `level[index]`, creating one that inherits the leaf's route if necessary
+  uint32_t child_of( std::vector<uint32_t>& level, size_t index );
+
+  // Call `rewrite` on every leaf entry of [first, first + count) in `level`, descending into chunks
+  template<class Rewrite>
+  void rewrite_range( std::vector<uint32_t>& level, size_t first, size_t count, Rewrite&& rewrite );
+};
@@ -22,82 +22,139 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
 // Address::ipv4_numeric() method.
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
-  uint32_t next_hop_ip = next_hop.ipv4_numeric();     // IP address of the next-hop router
+  send_datagram( InternetDatagram { dgram }, next_hop ); // copies only the payload's Buffer handles
+}
+
+// Serialize the header in front of the datagram's own payload Buffers
+static vector<Buffer> serialize( InternetDatagram&& dgram )
+{
+  Serializer s;
+  dgram.header.serialize( s );
+  s.buffer( std::move( dgram.payload ) );
+  return s.output();
+}
+
+void NetworkInterface::send_datagram( InternetDatagram&& dgram, const Address& next_hop )
+{
+  const uint32_t next_hop_ip = next_hop.ipv4_numeric(); // IP address of the next-hop router
+  if ( dgram.header.len <= mtu_ ) {
+    send_fitting( std::move( dgram ), next_hop_ip );
+    return;
+  }
+
+  fragments_.clear();
+  if ( not fragment_datagram( std::move( dgram ), mtu_, fragments_ ) ) {
+    ++too_big_dropped_;
+    return;
+  }
+  for ( auto& fragment : fragments_ ) {
+    send_fitting( std::move( fragment ), next_hop_ip );
+  }
+}
+
+void NetworkInterface::send_fitting( InternetDatagram&& dgram, const uint32_t next_hop_ip )
+{
   // if the destination Ethernet address is already known, send it right away
-  if (arp_cache.find(next_hop_ip) != arp_cache.end()) {
-    EthernetAddress corresponding = arp_cache[next_hop_ip].first;   // corresponding Ethernet address of next-hop router
-    EthernetFrame next;
-    next.header.type = EthernetHeader::TYPE_IPv4;
-    next.header.dst = corresponding;        // destination Ethernet address
-    next.header.src = ethernet_address_;    // source Ethernet address
-    // set the payload to be the serialized datagram
-    next.payload = serialize(dgram);
-    frames_out.emplace(next);
+  if ( ARPCache::Entry* mapping = arp_cache.find( next_hop_ip ) ) {
+    enqueue_frame( ipv4_frame( *mapping, serialize( std::move( dgram ) ) ) );
+
+    // soft expiry: ask the neighbor to confirm its address shortly before the mapping lapses
+    if ( not mapping->refresh_requested and mapping->expires_at < time + ARP_REFRESH_BEFORE_EXPIRY_MS ) {
+      send_arp_request( next_hop_ip, mapping->ethernet_address );
+      mapping->refresh_requested = true;
+    }
+    return;
+  }
+
+  auto [pending, inserted] = pending_resolution.try_emplace( next_hop_ip );
+  if ( inserted ) {
+    send_arp_request( next_hop_ip );
+    pending->second.requested_at = time;
   }
-  else if (arp_cache.find(next_hop_ip) == arp_cache.end()) {   
-    if (timing.count(next_hop_ip) == 0 || timing[next_hop_ip] + 5000 < time) {
-      // Construct ARP request message
-      ARPMessage arp;
-      arp.opcode = ARPMessage::OPCODE_REQUEST;    // request ARP message
-      arp.sender_ethernet_address = ethernet_address_;
-      arp.sender_ip_address = ip_address_.ipv4_numeric();
-      arp.target_ip_address = next_hop_ip;
-      // Construct Ethernet frame
-      EthernetFrame arp_request;
-      arp_request.header.src = ethernet_address_;
-      arp_request.header.dst = ETHERNET_BROADCAST;
-      arp_request.header.type = EthernetHeader::TYPE_ARP;
-      arp_request.payload = serialize(arp);
-      frames_out.emplace(arp_request);     // arp request message
-      timing[next_hop_ip] = time;   
-      // destination MAC address is temporarily empty
-      EthernetFrame next;
-      next.header.type = EthernetHeader::TYPE_IPv4;
-      next.header.src = ethernet_address_;
-      next.payload = serialize(dgram);
-      waiting_mac.emplace(make_pair(next_hop_ip, next));
+  // destination MAC address is not known yet: hold the datagram until it is
+  if ( pending->second.datagrams.size() < MAX_PENDING_PER_NEIGHBOR ) {
+    pending->second.datagrams.push_back( serialize( std::move( dgram ) ) );
+  } else {
+    ++pending_dropped_;
+  }
+}
+
+// Request the Ethernet address of `target_ip` (broadcast, or unicast to refresh a known mapping)
+void NetworkInterface::send_arp_request( const uint32_t target_ip, const EthernetAddress& destination )
+{
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REQUEST;
+  arp.sender_ethernet_address = ethernet_address_;
+  arp.sender_ip_address = ip_address_.ipv4_numeric();
+  arp.target_ip_address = target_ip;
+
+  EthernetFrame arp_request;
+  arp_request.header.src = ethernet_address_;
+  arp_request.header.dst = destination;
+  arp_request.header.type = EthernetHeader::TYPE_ARP;
+  arp_request.payload = serialize( arp );
+  enqueue_frame( std::move( arp_request ) );
+}
+
+EthernetFrame NetworkInterface::ipv4_frame( ARPCache::Entry& neighbor, vector<Buffer>&& payload ) const
+{
+  EthernetFrame frame;
+  frame.header = { neighbor.ethernet_address, ethernet_address_, EthernetHeader::TYPE_IPv4 };
+
+  // serialize the header the first time a frame goes to this neighbor; later frames share it
+  if ( neighbor.ethernet_header.empty() ) {
+    string image;
+    for ( const auto& piece : serialize( frame.header ) ) {
+      image.append( piece );
     }
+    neighbor.ethernet_header = Buffer { std::move( image ) };
   }
+  frame.set_header_image( neighbor.ethernet_header );
+  frame.payload = std::move( payload );
+  return frame;
 }
 
 // frame: the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
   // Ignore any frames not destined for the network interface
-  if (frame.header.dst != ETHERNET_BROADCAST && frame.header.dst != ethernet_address_) {
+  if ( frame.header.dst != ETHERNET_BROADCAST and frame.header.dst != ethernet_address_ ) {
     return std::nullopt;
   }
-  
+
   // if the inbound frame is IPv4, parse the payload as an InternetDatagram
-  if (frame.header.type == EthernetHeader::TYPE_IPv4) {
+  if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
     InternetDatagram internet_message;
-    if (parse(internet_message, frame.payload)) {    // On success, return the resulting InternetDatagram to the caller
-      return internet_message;
-    }
-    else {
+    if ( not parse( internet_message, frame.payload ) ) {
       return std::nullopt;
     }
+    // On success, return the resulting InternetDatagram to the caller
+    if ( reassembler_.has_value() ) {
+      return reassembler_->receive( std::move( internet_message ) );
+    }
+    return internet_message;
   }
 
-  if (frame.header.type == EthernetHeader::TYPE_ARP) {
+  if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
     ARPMessage arp_message;
-    bool flag = parse(arp_message, frame.payload);    // parse received ARP message and act accordingly
-    uint32_t my_ip = ip_address_.ipv4_numeric();
-    if (flag) {   
+    const bool flag = parse( arp_message, frame.payload ); // parse received ARP message and act accordingly
+    const uint32_t my_ip = ip_address_.ipv4_numeric();
+    if ( flag ) {
       // Learn mappings from both requests and replies
-      arp_cache[arp_message.sender_ip_address] = make_pair(arp_message.sender_ethernet_address, time);
-      
-      if (arp_message.opcode == ARPMessage::OPCODE_REPLY && arp_message.target_ip_address == my_ip) {
-        while (!waiting_mac.empty() && waiting_mac.front().first == arp_message.sender_ip_address) {
-        EthernetFrame curr = waiting_mac.front().second;
-        curr.header.dst = arp_message.sender_ethernet_address;    // fill the empty destination MAC address
-        frames_out.emplace(curr);
-        waiting_mac.pop();
-       }
-       return std::nullopt;
+      ARPCache::Entry& mapping
+        = arp_cache.learn( arp_message.sender_ip_address, arp_message.sender_ethernet_address, time );
+
+      // release everything that was waiting for this neighbor
+      auto pending = pending_resolution.find( arp_message.sender_ip_address );
+      if ( pending != pending_resolution.end() ) {
+        for ( auto& datagram : pending->second.datagrams ) {
+          enqueue_frame( ipv4_frame( mapping, std::move( datagram ) ) );
+        }
+        pending_resolution.erase( pending );
       }
-      else if (arp_message.opcode == ARPMessage::OPCODE_REQUEST && arp_message.target_ip_address == my_ip) {
-        ARPMessage reply;       // Construct an appropriate ARP reply message
+
+      if ( arp_message.opcode == ARPMessage::OPCODE_REQUEST and arp_message.target_ip_address == my_ip ) {
+        ARPMessage reply; // Construct an appropriate ARP reply message
         reply.opcode = ARPMessage::OPCODE_REPLY;
         reply.sender_ethernet_address = ethernet_address_;
         reply.sender_ip_address = my_ip;
@@ -107,9 +164,8 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
         carry.header.dst = arp_message.sender_ethernet_address;
         carry.header.src = ethernet_address_;
         carry.header.type = EthernetHeader::TYPE_ARP;
-        carry.payload = serialize(reply);
-        frames_out.emplace(carry);     // push current Ethernet frame into the waiting queue
-        return std::nullopt;
+        carry.payload = serialize( reply );
+        enqueue_frame( std::move( carry ) ); // push current Ethernet frame into the waiting queue
       }
     }
   }
@@ -119,27 +175,49 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
 // ms_since_last_tick: the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  time += ms_since_last_tick;    // update time
+  time += ms_since_last_tick; // update time
   // Expire any IP-to-Ethernet mappings that have expired
-  std::map<uint32_t, pair<EthernetAddress, size_t>>::iterator itr = arp_cache.begin();
-  while (itr != arp_cache.end()) {
-    if (itr -> second.second + 30000 <= time) {
-      itr = arp_cache.erase(itr);
-    }
-    else {
-      ++itr;
+  arp_cache.expire( time );
+
+  // Give up on ARP requests that went unanswered, dropping the datagrams waiting on them
+  erase_if( pending_resolution, [&]( const auto& pending ) {
+    if ( pending.second.requested_at + ARP_REQUEST_TIMEOUT_MS < time ) {
+      pending_dropped_ += pending.second.datagrams.size();
+      return true;
     }
+    return false;
+  } );
+
+  if ( reassembler_.has_value() ) {
+    reassembler_->tick( ms_since_last_tick );
   }
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
 {
-  if (!frames_out.empty()) {      // if the queue is not empty
-    EthernetFrame next = frames_out.front();
+  if ( frames_out.empty() ) {
+    return std::nullopt;
+  }
+  EthernetFrame next = std::move( frames_out.front() );
+  frames_out.pop();
+  return next;
+}
+
+size_t NetworkInterface::drain( vector<EthernetFrame>& out, const size_t max )
+{
+  size_t moved = 0;
+  for ( ; moved < max and not frames_out.empty(); ++moved ) {
+    out.push_back( std::move( frames_out.front() ) );
     frames_out.pop();
-    return next;
   }
-  else {
-    return std::nullopt;
+  return moved;
+}
+
+void NetworkInterface::enqueue_frame( EthernetFrame&& frame )
+{
+  if ( frames_out.size() >= max_frames_out_ ) {
+    ++frames_dropped_;
+    return;
   }
+  frames_out.push( std::move( frame ) );
 }
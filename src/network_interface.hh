@@ -1,9 +1,12 @@
 #pragma once
 
 #include "address.hh"
+#include "arp_cache.hh"
 #include "ethernet_frame.hh"
+#include "ip_fragments.hh"
 #include "ipv4_datagram.hh"
 
+#include <deque>
 #include <iostream>
 #include <list>
 #include <map>
@@ -42,11 +45,50 @@ private:
   // IP (known as Internet-layer or network-layer) address of the interface
   Address ip_address_;
   size_t time = 0;                  // used to represent time. millisecond
-  std::map<uint32_t, std::pair<EthernetAddress, size_t>> arp_cache {};  // IP_address and corresponding Ethernet address and time when the mapping is recorded 
-  // map<uint32_t, EthernetAddress> arp_cache;    // used to record the mapping between IP address and Ethernet address
+  ARPCache arp_cache {};            // IP address => Ethernet address, for 30 seconds after it was learned
   std::queue<EthernetFrame> frames_out {};
-  std::queue<std::pair<uint32_t, EthernetFrame>> waiting_mac {};  // IP address and EthernetFrame, represent those waiting for the ARP reply
-  std::map<uint32_t, size_t> timing {};       // record the time when last arp request was sent
+
+  // Frames awaiting transmission are bounded: once `max_frames_out_` are queued, further
+  // frames are dropped (and counted) rather than letting the queue grow without limit
+  static constexpr size_t DEFAULT_MAX_FRAMES_OUT = 4096;
+  size_t max_frames_out_ = DEFAULT_MAX_FRAMES_OUT;
+  uint64_t frames_dropped_ {};
+
+  void enqueue_frame( EthernetFrame&& frame );
+
+  // Datagrams waiting for the Ethernet address of their next hop, kept per next hop so that
+  // an unanswered neighbor never holds up the others. An ARP request is outstanding for
+  // each; when it goes unanswered for five seconds its datagrams are dropped.
+  struct PendingResolution
+  {
+    size_t requested_at {};                       // time the ARP request was sent
+    std::deque<std::vector<Buffer>> datagrams {}; // serialized, in the order they were sent
+  };
+  static constexpr size_t ARP_REQUEST_TIMEOUT_MS = 5000;
+  static constexpr size_t MAX_PENDING_PER_NEIGHBOR = 64; // further datagrams are dropped
+  std::unordered_map<uint32_t, PendingResolution> pending_resolution {};
+  uint64_t pending_dropped_ {};
+
+  // Mappings in use are refreshed (with a unicast ARP request, while still being used) once
+  // they are less than this far from expiring, so busy neighbors never wait for a fresh resolution
+  static constexpr size_t ARP_REFRESH_BEFORE_EXPIRY_MS = 5000;
+
+  // Datagrams larger than the MTU are fragmented (or dropped, if they have DF set)
+  static constexpr size_t DEFAULT_MTU = 1500;
+  size_t mtu_ = DEFAULT_MTU;
+  uint64_t too_big_dropped_ {};
+  std::vector<InternetDatagram> fragments_ {}; // scratch space, reused
+
+  // Received fragments are put back together only if enabled (a router forwards them as they are)
+  std::optional<DatagramReassembler> reassembler_ {};
+
+  void send_arp_request( uint32_t target_ip, const EthernetAddress& destination = ETHERNET_BROADCAST );
+
+  // Send a datagram that fits in the MTU
+  void send_fitting( InternetDatagram&& dgram, uint32_t next_hop_ip );
+
+  // An IPv4 frame to a resolved neighbor, reusing the neighbor's pre-serialized Ethernet header
+  EthernetFrame ipv4_frame( ARPCache::Entry& neighbor, std::vector<Buffer>&& payload ) const;
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
   // addresses
@@ -55,6 +97,9 @@ public:
   // Access queue of Ethernet frames awaiting transmission
   std::optional<EthernetFrame> maybe_send();
 
+  // Move up to `max` frames awaiting transmission onto the end of `out`; returns how many were moved
+  size_t drain( std::vector<EthernetFrame>& out, size_t max );
+
   // Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination
   // address). Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address
   // for the next hop.
@@ -62,6 +107,10 @@ public:
   // but please consider the frame sent as soon as it is generated.)
   void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
 
+  // As above, but takes ownership of the datagram: its payload Buffers become the frame's
+  // payload as they are, and only the header is serialized (forwarding is O(header))
+  void send_datagram( InternetDatagram&& dgram, const Address& next_hop );
+
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, returns the datagram.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
@@ -70,4 +119,25 @@ public:
 
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
+
+  // Datagrams dropped while waiting for ARP (queue full, or the request went unanswered)
+  uint64_t pending_dropped() const { return pending_dropped_; }
+
+  // The interface's IP address (e.g. the source of the ICMP errors a router sends from it)
+  const Address& ip_address() const { return ip_address_; }
+
+  // Largest datagram (header included) sent in one frame
+  void set_mtu( size_t mtu ) { mtu_ = mtu; }
+  size_t mtu() const { return mtu_; }
+  uint64_t too_big_dropped() const { return too_big_dropped_; } // over the MTU and could not be fragmented
+
+  // Reassemble received fragments, so that recv_frame() returns only whole datagrams
+  void enable_reassembly( const DatagramReassembler::Config& config ) { reassembler_.emplace( config ); }
+  void enable_reassembly() { reassembler_.emplace(); }
+  const std::optional<DatagramReassembler>& reassembler() const { return reassembler_; }
+
+  // Bound on frames awaiting transmission (frames beyond it are dropped)
+  void set_max_frames_out( size_t max_frames ) { max_frames_out_ = max_frames; }
+  size_t frames_queued() const { return frames_out.size(); }
+  uint64_t frames_dropped() const { return frames_dropped_; }
 };
\ No newline at end of file
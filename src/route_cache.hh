@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A direct-mapped cache of longest-prefix-match results, keyed by destination address.
+//
+// Each slot holds one address, the value the routing table gave for it, and the
+// generation of the routing table at the time. The owner bumps the generation
+// whenever routes change, which invalidates every slot at once without touching them.
+class RouteCache
+{
+  struct Slot
+  {
+    uint32_t address {};
+    uint32_t value {};
+    uint64_t generation {}; // 0: never filled
+  };
+
+  std::vector<Slot> slots_;
+  unsigned shift_; // 32 - log2(number of slots)
+  uint64_t hits_ {};
+  uint64_t misses_ {};
+
+  static unsigned log2_ceil( size_t n )
+  {
+    unsigned bits = 0;
+    while ( ( size_t { 1 } << bits ) < n and bits < 32 ) {
+      ++bits;
+    }
+    return bits;
+  }
+
+public:
+  // A cache with at least `num_slots` slots (rounded up to a power of two)
+  explicit RouteCache( const size_t num_slots )
+    : slots_( size_t { 1 } << log2_ceil( num_slots ) ), shift_( 32 - log2_ceil( num_slots ) )
+  {}
+
+  // The cached value for `address` if it was cached at `generation` (which must be nonzero),
+  // otherwise the result of `miss()`, which is then cached
+  template<class Miss>
+  uint32_t lookup( const uint32_t address, const uint64_t generation, Miss&& miss )
+  {
+    // Fibonacci hashing spreads neighbouring addresses across the slots
+    const size_t index = shift_ == 32 ? 0 : static_cast<uint32_t>( address * 2654435769U ) >> shift_;
+    Slot& slot = slots_[index];
+    if ( slot.generation == generation and slot.address == address ) {
+      ++hits_;
+      return slot.value;
+    }
+
+    ++misses_;
+    slot = { address, miss(), generation };
+    return slot.value;
+  }
+
+  size_t size() const { return slots_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+};
@@ -1,10 +1,95 @@
 #include "router.hh"
+#include "spsc_ring.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <limits>
+#include <set>
+#include <stdexcept>
+#include <thread>
 
 using namespace std;
 
+// A datagram handed from the worker that received it to the worker of its output interface
+struct Handoff
+{
+  InternetDatagram datagram {};
+  size_t interface_num {};
+  optional<Address> next_hop {};
+};
+
+struct Router::Parallel
+{
+  struct Worker
+  {
+    Burst burst {};
+    optional<RouteCache> cache {};
+    deque<Handoff> pending {}; // routed, but the ring to the output interface was full
+    bool more = false;         // work was left over at the end of the round
+    exception_ptr error {};    // the first exception thrown during the round, for route() to rethrow
+  };
+
+  size_t num_workers;
+  vector<unique_ptr<SPSCRing<Handoff>>> rings {}; // rings[from * num_workers + to]
+  vector<Worker> workers;
+  barrier<> phase;                // the workers and the thread calling route()
+  atomic<bool> stopping { false };
+  vector<jthread> threads {};     // last, so the threads are joined before the rest is destroyed
+
+  Parallel( const size_t n, const size_t ring_capacity ) : num_workers( n ), workers( n ), phase( n + 1 )
+  {
+    for ( size_t i = 0; i < n * n; ++i ) {
+      rings.push_back( make_unique<SPSCRing<Handoff>>( ring_capacity ) );
+    }
+  }
+
+  SPSCRing<Handoff>& ring( const size_t from, const size_t to ) { return *rings[from * num_workers + to]; }
+
+  ~Parallel()
+  {
+    stopping = true;
+    phase.arrive_and_wait(); // release the workers from the start of the next round
+    threads.clear();
+  }
+
+  Parallel( const Parallel& other ) = delete;
+  Parallel& operator=( const Parallel& other ) = delete;
+};
+
+namespace {
+
+// How next_hop_index_ identifies a next hop
+pair<size_t, optional<uint32_t>> next_hop_key( const optional<Address>& next_hop, const size_t interface_num )
+{
+  optional<uint32_t> next_hop_ip;
+  if ( next_hop.has_value() ) {
+    next_hop_ip = next_hop->ipv4_numeric();
+  }
+  return { interface_num, next_hop_ip };
+}
+
+} // namespace
+
+Router::Router() : parallel_() {}
+
+Router::~Router() = default;
+
+size_t Router::add_interface( AsyncNetworkInterface&& interface )
+{
+  if ( parallel_ ) {
+    throw runtime_error( "Router: add interfaces before enabling parallel forwarding" );
+  }
+  interfaces_.push_back( std::move( interface ) );
+  if ( icmp_enabled_ ) {
+    icmp_buckets_.emplace_back( icmp_rate_per_second_, icmp_burst_ );
+  }
+  return interfaces_.size() - 1;
+}
+
 // route_prefix: The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 // prefix_length: For this route to be applicable, how many high-order (most-significant) bits of
 //    the route_prefix will need to match the corresponding bits of the datagram's destination address?
@@ -19,48 +104,463 @@ void Router::add_route( const uint32_t route_prefix,
   cerr << "DEBUG: adding route " << Address::from_ipv4_numeric( route_prefix ).ip() << "/"
        << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
        << " on interface " << interface_num << "\n";
-  // RouterTableEntry new_item = {route_prefix, prefix_length, next_hop, interface_num};  // add a new routing rule
-  // routing_table.emplace_back(new_item);
-  routing_table.push_back(RouterTableEntry{route_prefix, prefix_length, next_hop, interface_num});
+  update_routes( { { route_prefix, prefix_length, next_hop, interface_num } } );
 }
 
+bool Router::remove_route( const uint32_t route_prefix, const uint8_t prefix_length )
+{
+  const size_t before = routing_table_.get().prefixes.size();
+  update_routes( { { .route_prefix = route_prefix, .prefix_length = prefix_length, .remove = true } } );
+  return routing_table_.get().prefixes.size() < before;
+}
 
-void Router::route() {
-  for (auto & inter : interfaces_) {
-    while (1) {
-      std::optional<InternetDatagram> data = inter.maybe_receive();
-      if (!data.has_value()) {  // if current queue runs out of items
-        break;
+void Router::update_routes( const vector<RouteUpdate>& updates )
+{
+  // refuse a bad batch before anything changes: a writer that threw partway through would leave
+  // the two copies of the table (and their generations) permanently different
+  set<pair<size_t, optional<uint32_t>>> new_next_hops;
+  for ( const auto& update : updates ) {
+    if ( update.prefix_length > 32 ) {
+      throw runtime_error( "Router: prefix length must be at most 32" );
+    }
+    if ( not update.remove ) {
+      const auto key = next_hop_key( update.next_hop, update.interface_num );
+      if ( not next_hop_index_.contains( key ) ) {
+        new_next_hops.insert( key );
+      }
+    }
+  }
+  if ( next_hop_index_.size() + new_next_hops.size() > size_t { LPMTable::MAX_VALUE } + 1 ) {
+    throw runtime_error( "Router: too many distinct next hops" );
+  }
+
+  // intern next hops up front, so both copies of the table assign them the same indices
+  vector<uint32_t> indices;
+  indices.reserve( updates.size() );
+  for ( const auto& update : updates ) {
+    indices.push_back( update.remove ? 0 : intern_next_hop( update.next_hop, update.interface_num ) );
+  }
+  const size_t num_next_hops = next_hop_index_.size();
+
+  // every update has been checked, so neither LPMTable call below can throw
+  routing_table_.modify( [&]( RoutingTable& table ) noexcept {
+    ++table.generation;
+    table.next_hops.resize( num_next_hops );
+    for ( size_t i = 0; i < updates.size(); ++i ) {
+      const RouteUpdate& update = updates[i];
+      if ( update.remove ) {
+        table.prefixes.erase( update.route_prefix, update.prefix_length );
+      } else {
+        table.next_hops[indices[i]] = { update.next_hop, update.interface_num };
+        table.prefixes.insert( update.route_prefix, update.prefix_length, indices[i] );
+      }
+    }
+  } );
+}
+
+uint32_t Router::intern_next_hop( const optional<Address>& next_hop, const size_t interface_num )
+{
+  const auto index = static_cast<uint32_t>( next_hop_index_.size() );
+  return next_hop_index_.try_emplace( next_hop_key( next_hop, interface_num ), index ).first->second;
+}
+
+
+void Router::resolve( Burst& burst, optional<RouteCache>& cache ) const
+{
+  // drop datagrams whose TTL would expire here
+  burst.undeliverable.clear();
+  if ( icmp_enabled_ ) {
+    for ( const auto& dgram : burst.datagrams ) {
+      if ( dgram.header.ttl <= 1 ) {
+        burst.undeliverable.push_back(
+          { dgram, ICMPMessage::TYPE_TIME_EXCEEDED, ICMPMessage::CODE_TTL_EXCEEDED, 0 } );
       }
-      InternetDatagram dgram = data.value();
-      if (dgram.header.ttl <= 1) {    // early exit
+    }
+  }
+  erase_if( burst.datagrams, []( const InternetDatagram& dgram ) { return dgram.header.ttl <= 1; } );
+
+  burst.destinations.clear();
+  for ( const auto& dgram : burst.datagrams ) {
+    burst.destinations.push_back( dgram.header.dst );
+  }
+  burst.routes.resize( burst.datagrams.size() );
+  burst.next_hops.resize( burst.datagrams.size() );
+
+  // look up the whole burst under one read of the table, copying out the next hops before it can
+  // change (the lookups are independent, so the CPU overlaps their cache misses)
+  routing_table_.read( [&]( const RoutingTable& table ) {
+    for ( size_t i = 0; i < burst.datagrams.size(); ++i ) {
+      const uint32_t dst = burst.destinations[i];
+      burst.routes[i] = cache.has_value()
+                          ? cache->lookup( dst, table.generation, [&] { return table.prefixes.lookup( dst ); } )
+                          : table.prefixes.lookup( dst );
+    }
+    for ( size_t i = 0; i < burst.datagrams.size(); ++i ) {
+      if ( burst.routes[i] != LPMTable::NO_ROUTE ) {
+        burst.next_hops[i] = table.next_hops[burst.routes[i]];
+      }
+    }
+  } );
+
+  for ( size_t i = 0; i < burst.datagrams.size(); ++i ) {
+    InternetDatagram& dgram = burst.datagrams[i];
+
+    // a route to an interface the router does not have: drop (in parallel mode there is no ring to it)
+    const size_t out = burst.next_hops[i].interface_num;
+    if ( burst.routes[i] != LPMTable::NO_ROUTE and out >= interfaces_.size() ) {
+      burst.routes[i] = LPMTable::NO_ROUTE;
+      ++burst.misrouted;
+      continue;
+    }
+
+    if ( not icmp_enabled_ ) {
+      if ( burst.routes[i] != LPMTable::NO_ROUTE ) {
+        dgram.header.decrement_ttl();
+      }
+      continue;
+    }
+
+    if ( burst.routes[i] == LPMTable::NO_ROUTE ) {
+      burst.undeliverable.push_back(
+        { std::move( dgram ), ICMPMessage::TYPE_DESTINATION_UNREACHABLE, ICMPMessage::CODE_NET_UNREACHABLE, 0 } );
+      continue;
+    }
+
+    // the output interface would have to drop it (reading its MTU is safe from any worker: it is
+    // only ever set between calls to route())
+    if ( dgram.header.df and dgram.header.len > interfaces_[out].mtu() ) {
+      const auto mtu = static_cast<uint16_t>( min<size_t>( interfaces_[out].mtu(), UINT16_MAX ) );
+      burst.undeliverable.push_back( { std::move( dgram ),
+                                       ICMPMessage::TYPE_DESTINATION_UNREACHABLE,
+                                       ICMPMessage::CODE_FRAGMENTATION_NEEDED,
+                                       mtu } );
+      burst.routes[i] = LPMTable::NO_ROUTE;
+      continue;
+    }
+
+    dgram.header.decrement_ttl();
+  }
+}
+
+void Router::group_by_output( Burst& burst ) const
+{
+  // a counting sort, which is stable: each interface's datagrams keep their arrival order
+  burst.output_starts.assign( interfaces_.size() + 1, 0 );
+  for ( size_t i = 0; i < burst.datagrams.size(); ++i ) {
+    if ( burst.routes[i] != LPMTable::NO_ROUTE ) {
+      ++burst.output_starts[burst.next_hops[i].interface_num + 1];
+    }
+  }
+  for ( size_t out = 1; out < burst.output_starts.size(); ++out ) {
+    burst.output_starts[out] += burst.output_starts[out - 1];
+  }
+
+  burst.by_output.resize( burst.output_starts.back() );
+  for ( size_t i = 0; i < burst.datagrams.size(); ++i ) {
+    if ( burst.routes[i] != LPMTable::NO_ROUTE ) {
+      burst.by_output[burst.output_starts[burst.next_hops[i].interface_num]++] = i;
+    }
+  }
+}
+
+void Router::send_icmp_errors( const size_t ingress, Burst& burst )
+{
+  AsyncNetworkInterface& inter = interfaces_[ingress];
+  for ( auto& [dgram, type, code, next_hop_mtu] : burst.undeliverable ) {
+    const IPv4Header& offending = dgram.header;
+
+    // never about non-initial fragments or datagrams without a unicast source (RFC 1812 4.3.2.7)
+    const bool unicast_source = offending.src != 0 and offending.src < 0xe0000000 and offending.src != UINT32_MAX;
+    if ( offending.offset != 0 or not unicast_source ) {
+      continue;
+    }
+
+    // nor about ICMP errors
+    if ( offending.proto == IPv4Header::PROTO_ICMP ) {
+      const auto first = ranges::find_if( dgram.payload, []( const Buffer& buf ) { return not buf.empty(); } );
+      if ( first == dgram.payload.end() or ICMPMessage::is_error( string_view { *first }.front() ) ) {
         continue;
       }
-      size_t index = 0;
-      bool flag = false;
-      uint8_t longest = 0;
-      for (size_t i = 0; i < routing_table.size(); i++) {
-        if (routing_table[i].prefix_length >= longest) {
-          uint32_t mask = routing_table[i].prefix_length == 0 ? 0 : (0xFFFFFFFF << (32 - routing_table[i].prefix_length));
-          if ((dgram.header.dst & mask) == (routing_table[i].route_prefix & mask)) {
-            flag = true;     // find one item at least
-            index = i;
-            longest = routing_table[i].prefix_length;
-          }
+    }
+
+    // the error leaves through the interface the datagram came in on, if that is the way back
+    optional<NextHop> way_back;
+    routing_table_.read( [&]( const RoutingTable& table ) {
+      const uint32_t route = table.prefixes.lookup( offending.src );
+      if ( route != LPMTable::NO_ROUTE ) {
+        way_back = table.next_hops[route];
+      }
+    } );
+    if ( not way_back.has_value() or way_back->interface_num != ingress or not icmp_buckets_[ingress].try_take() ) {
+      continue;
+    }
+
+    // quote the offending datagram's header and the first bytes of its payload (no copy)
+    ICMPMessage icmp;
+    icmp.type = type;
+    icmp.code = code;
+    icmp.rest = next_hop_mtu;
+    icmp.payload = serialize( offending );
+    size_t quoted = 0;
+    for ( const auto& buf : dgram.payload ) {
+      if ( quoted == ICMPMessage::QUOTED_PAYLOAD ) {
+        break;
+      }
+      const size_t take = min( buf.size(), ICMPMessage::QUOTED_PAYLOAD - quoted );
+      icmp.payload.push_back( buf.substr( 0, take ) );
+      quoted += take;
+    }
+    icmp.compute_checksum();
+
+    InternetDatagram error;
+    error.header.src = inter.ip_address().ipv4_numeric();
+    error.header.dst = offending.src;
+    error.header.proto = IPv4Header::PROTO_ICMP;
+    error.payload = serialize( icmp );
+    size_t length = IPv4Header::LENGTH;
+    for ( const auto& buf : error.payload ) {
+      length += buf.size();
+    }
+    error.header.len = static_cast<uint16_t>( length );
+    error.header.compute_checksum();
+
+    send( inter, std::move( error ), *way_back );
+  }
+}
+
+void Router::enable_icmp_errors( const uint64_t rate_per_second, const uint64_t burst )
+{
+  icmp_enabled_ = true;
+  icmp_rate_per_second_ = rate_per_second;
+  icmp_burst_ = burst;
+  icmp_buckets_.assign( interfaces_.size(), TokenBucket { rate_per_second, burst } );
+}
+
+uint64_t Router::icmp_errors_sent() const
+{
+  uint64_t sent = 0;
+  for ( const auto& bucket : icmp_buckets_ ) {
+    sent += bucket.taken();
+  }
+  return sent;
+}
+
+uint64_t Router::icmp_errors_rate_limited() const
+{
+  uint64_t refused = 0;
+  for ( const auto& bucket : icmp_buckets_ ) {
+    refused += bucket.refused();
+  }
+  return refused;
+}
+
+void Router::tick( const uint64_t ms_since_last_tick )
+{
+  for ( auto& bucket : icmp_buckets_ ) {
+    bucket.refill( ms_since_last_tick );
+  }
+}
+
+void Router::send( AsyncNetworkInterface& interface, InternetDatagram&& dgram, const NextHop& hop )
+{
+  if ( hop.address.has_value() ) {
+    interface.send_datagram( std::move( dgram ), hop.address.value() );
+  } else {
+    const uint32_t dst = dgram.header.dst;
+    interface.send_datagram( std::move( dgram ), Address::from_ipv4_numeric( dst ) );
+  }
+}
+
+void Router::route()
+{
+  if ( parallel_ ) {
+    route_parallel();
+  } else {
+    route_serial();
+  }
+}
+
+void Router::route_serial()
+{
+  for ( size_t in = 0; in < interfaces_.size(); ++in ) {
+    while ( true ) {
+      burst_.datagrams.clear();
+      if ( interfaces_[in].maybe_receive_batch( burst_.datagrams, BATCH_SIZE ) == 0 ) {
+        break;
+      }
+
+      resolve( burst_, route_cache_ );
+      group_by_output( burst_ );
+      for ( const size_t i : burst_.by_output ) {
+        const NextHop& hop = burst_.next_hops[i];
+        send( interfaces_[hop.interface_num], std::move( burst_.datagrams[i] ), hop );
+      }
+      send_icmp_errors( in, burst_ );
+    }
+  }
+}
+
+void Router::enable_parallel( const size_t ring_capacity )
+{
+  if ( parallel_ ) {
+    return;
+  }
+
+  parallel_ = make_unique<Parallel>( interfaces_.size(), ring_capacity );
+  for ( size_t i = 0; i < interfaces_.size(); ++i ) {
+    if ( route_cache_.has_value() ) {
+      parallel_->workers[i].cache.emplace( route_cache_->size() );
+    }
+    parallel_->threads.emplace_back( [this, i] { worker_loop( i ); } );
+  }
+}
+
+void Router::disable_parallel()
+{
+  if ( parallel_ ) {
+    for ( const auto& worker : parallel_->workers ) {
+      burst_.misrouted += worker.burst.misrouted;
+      if ( worker.cache.has_value() ) {
+        retired_cache_hits_ += worker.cache->hits();
+        retired_cache_misses_ += worker.cache->misses();
+      }
+    }
+  }
+  parallel_.reset();
+}
+
+uint64_t Router::route_cache_hits() const
+{
+  uint64_t hits = retired_cache_hits_ + ( route_cache_.has_value() ? route_cache_->hits() : 0 );
+  if ( parallel_ ) {
+    for ( const auto& worker : parallel_->workers ) {
+      hits += worker.cache.has_value() ? worker.cache->hits() : 0;
+    }
+  }
+  return hits;
+}
+
+uint64_t Router::route_cache_misses() const
+{
+  uint64_t misses = retired_cache_misses_ + ( route_cache_.has_value() ? route_cache_->misses() : 0 );
+  if ( parallel_ ) {
+    for ( const auto& worker : parallel_->workers ) {
+      misses += worker.cache.has_value() ? worker.cache->misses() : 0;
+    }
+  }
+  return misses;
+}
+
+uint64_t Router::datagrams_misrouted() const
+{
+  uint64_t misrouted = burst_.misrouted;
+  if ( parallel_ ) {
+    for ( const auto& worker : parallel_->workers ) {
+      misrouted += worker.burst.misrouted;
+    }
+  }
+  return misrouted;
+}
+
+void Router::route_parallel()
+{
+  Parallel& parallel = *parallel_;
+  bool more = true;
+  while ( more ) {
+    parallel.phase.arrive_and_wait(); // start a round
+    parallel.phase.arrive_and_wait(); // every worker has handed off what it received
+    parallel.phase.arrive_and_wait(); // every worker has sent what was handed to it
+
+    more = false;
+    exception_ptr error;
+    for ( auto& worker : parallel.workers ) {
+      more = more or worker.more;
+      if ( worker.error and not error ) {
+        error = worker.error;
+      }
+      worker.error = nullptr;
+    }
+    if ( error ) {
+      rethrow_exception( error ); // the workers are waiting for the next round, as after any other
+    }
+  }
+}
+
+void Router::worker_loop( const size_t worker_num )
+{
+  Parallel& parallel = *parallel_;
+  Parallel::Worker& me = parallel.workers[worker_num];
+  AsyncNetworkInterface& inter = interfaces_[worker_num];
+
+  while ( true ) {
+    parallel.phase.arrive_and_wait();
+    if ( parallel.stopping ) {
+      return;
+    }
+
+    // Phase 1: route what this worker's interface received. An exception is kept for route()
+    // to rethrow rather than ending the thread, which must still reach every barrier.
+    try {
+      handoff_received( worker_num );
+    } catch ( ... ) {
+      me.error = current_exception();
+    }
+    me.more = not me.pending.empty();
+
+    parallel.phase.arrive_and_wait();
+
+    // Phase 2: send everything handed to this worker's interface
+    try {
+      for ( size_t from = 0; from < parallel.num_workers; ++from ) {
+        while ( optional<Handoff> handoff = parallel.ring( from, worker_num ).pop() ) {
+          send( inter, std::move( handoff->datagram ), { std::move( handoff->next_hop ), handoff->interface_num } );
         }
       }
-      if (!flag) {
-        continue;
+    } catch ( ... ) {
+      if ( not me.error ) {
+        me.error = current_exception();
       }
-      dgram.header.ttl -= 1;
-      AsyncNetworkInterface& forward = interface(routing_table[index].interface_num);
-      if (routing_table[index].next_hop.has_value()) {
-        forward.send_datagram(dgram, routing_table[index].next_hop.value());
+    }
+
+    parallel.phase.arrive_and_wait();
+  }
+}
+
+// Hand off datagrams left over from the last round, then (if they all fit) receive, route and
+// hand off new ones. Rings are not drained during this phase, so once a ring is full every
+// later datagram for that output waits too, keeping them in order.
+void Router::handoff_received( const size_t worker_num )
+{
+  Parallel& parallel = *parallel_;
+  Parallel::Worker& me = parallel.workers[worker_num];
+  AsyncNetworkInterface& inter = interfaces_[worker_num];
+
+  deque<Handoff> still_pending;
+  for ( auto& handoff : me.pending ) {
+    if ( not parallel.ring( worker_num, handoff.interface_num ).push( std::move( handoff ) ) ) {
+      still_pending.push_back( std::move( handoff ) );
+    }
+  }
+  me.pending = std::move( still_pending );
+
+  while ( me.pending.empty() ) {
+    me.burst.datagrams.clear();
+    if ( inter.maybe_receive_batch( me.burst.datagrams, BATCH_SIZE ) == 0 ) {
+      break;
+    }
+
+    resolve( me.burst, me.cache );
+    for ( size_t i = 0; i < me.burst.datagrams.size(); ++i ) {
+      if ( me.burst.routes[i] == LPMTable::NO_ROUTE ) {
+        continue;
       }
-      else {
-        forward.send_datagram(dgram, Address::from_ipv4_numeric(dgram.header.dst));
+      const NextHop& hop = me.burst.next_hops[i];
+      Handoff handoff { std::move( me.burst.datagrams[i] ), hop.interface_num, hop.address };
+      if ( not parallel.ring( worker_num, hop.interface_num ).push( std::move( handoff ) ) ) {
+        me.pending.push_back( std::move( handoff ) );
       }
     }
+    send_icmp_errors( worker_num, me.burst ); // on this worker's own interface
   }
 }
 
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "icmp_message.hh"
+#include "left_right.hh"
+#include "lpm_table.hh"
 #include "network_interface.hh"
+#include "route_cache.hh"
+#include "token_bucket.hh"
 
+#include <map>
+#include <memory>
 #include <optional>
 #include <queue>
 
@@ -46,6 +53,17 @@ public:
     datagrams_in_.pop();
     return datagram;
   }
+
+  // Move up to `max` received datagrams onto the end of `out`; returns how many were moved
+  size_t maybe_receive_batch( std::vector<InternetDatagram>& out, size_t max )
+  {
+    size_t moved = 0;
+    for ( ; moved < max and not datagrams_in_.empty(); ++moved ) {
+      out.push_back( std::move( datagrams_in_.front() ) );
+      datagrams_in_.pop();
+    }
+    return moved;
+  }
 };
 
 // A router that has multiple network interfaces and
@@ -55,32 +73,152 @@ class Router
   // The router's collection of network interfaces
   std::vector<AsyncNetworkInterface> interfaces_ {};
 
-  struct RouterTableEntry {
-    const uint32_t route_prefix;
-    const uint8_t prefix_length;
-    const std::optional<Address> next_hop;
-    const size_t interface_num;
+  // Where a route sends matching datagrams. Routes usually share a handful of next hops,
+  // so each distinct one is stored once and the routing table maps prefixes to its index.
+  struct NextHop {
+    std::optional<Address> address {};
+    size_t interface_num {};
+  };
+
+  struct RoutingTable {
+    LPMTable prefixes {};               // prefix => index into next_hops
+    std::vector<NextHop> next_hops {};  // only ever appended to
+    uint64_t generation = 1;            // bumped by every update, to invalidate route caches
+  };
+
+  // Route lookups read the published copy while updates are applied to the other one
+  LeftRight<RoutingTable> routing_table_ {};
+  std::map<std::pair<size_t, std::optional<uint32_t>>, uint32_t> next_hop_index_ {};
+
+  std::optional<RouteCache> route_cache_ {};  // destination => index into next_hops, if enabled
+  uint64_t retired_cache_hits_ {};    // from the workers' caches, once parallel forwarding is disabled
+  uint64_t retired_cache_misses_ {};
+
+  // A datagram that could not be forwarded, and the ICMP error that reports it
+  struct Undeliverable {
+    InternetDatagram datagram {};
+    uint8_t type {};
+    uint8_t code {};
+    uint16_t next_hop_mtu {};  // for Fragmentation Needed
+  };
+
+  // Datagrams are routed in bursts of up to BATCH_SIZE from each interface
+  static constexpr size_t BATCH_SIZE = 32;
+  struct Burst {
+    std::vector<InternetDatagram> datagrams {};
+    std::vector<uint32_t> destinations {};
+    std::vector<uint32_t> routes {};  // index into next_hops, or LPMTable::NO_ROUTE to drop the datagram
+    std::vector<NextHop> next_hops {};
+    std::vector<Undeliverable> undeliverable {};  // collected only if ICMP errors are enabled
+    uint64_t misrouted {};  // datagrams dropped because their route names a nonexistent interface
+    std::vector<size_t> by_output {};  // indices of the routed datagrams, grouped by output interface
+    std::vector<size_t> output_starts {};  // scratch space for grouping them
   };
-  std::vector<RouterTableEntry> routing_table {};  // current routing table
+  Burst burst_ {};
+
+  // Parallel forwarding state (one worker thread per interface), if enabled
+  struct Parallel;
+  std::unique_ptr<Parallel> parallel_;
+
+  // ICMP errors, if enabled, are sent from the interface the offending datagram arrived on,
+  // at a rate limited by that interface's own token bucket (so parallel workers never share one)
+  bool icmp_enabled_ = false;
+  uint64_t icmp_rate_per_second_ {};
+  uint64_t icmp_burst_ {};
+  std::vector<TokenBucket> icmp_buckets_ {};  // one per interface
+
+  uint32_t intern_next_hop( const std::optional<Address>& next_hop, size_t interface_num );
+
+  // Look up the routes for a burst, dropping datagrams whose TTL expires, that have no route, or
+  // that are too big for their output interface but may not be fragmented (keeping them in
+  // burst.undeliverable if ICMP errors are enabled), and decrement the TTLs
+  void resolve( Burst& burst, std::optional<RouteCache>& cache ) const;
+
+  // Order the burst's routed datagrams by output interface into burst.by_output, so that each
+  // interface is sent its share of the burst in one run
+  void group_by_output( Burst& burst ) const;
+
+  // Report the burst's undeliverable datagrams to their senders, out of interface `ingress`
+  void send_icmp_errors( size_t ingress, Burst& burst );
+
+  static void send( AsyncNetworkInterface& interface, InternetDatagram&& dgram, const NextHop& hop );
+
+  void route_serial();
+  void route_parallel();
+  void worker_loop( size_t worker );
+  void handoff_received( size_t worker );
+
 public:
+  Router();
+  ~Router();
+
   // Add an interface to the router
   // interface: an already-constructed network interface
   // returns the index of the interface after it has been added to the router
-  size_t add_interface( AsyncNetworkInterface&& interface )
-  {
-    interfaces_.push_back( std::move( interface ) );
-    return interfaces_.size() - 1;
-  }
+  size_t add_interface( AsyncNetworkInterface&& interface );
 
   // Access an interface by index
   AsyncNetworkInterface& interface( size_t N ) { return interfaces_.at( N ); }
 
-  // Add a route (a forwarding rule)
+  // Add a route (a forwarding rule), replacing any route for the same prefix
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Datagrams dropped because their route's interface_num is not one of the router's interfaces
+  uint64_t datagrams_misrouted() const;
+
+  // Remove the route for exactly this prefix; returns false if there was none
+  bool remove_route( uint32_t route_prefix, uint8_t prefix_length );
+
+  // A change to the routing table: add (or replace) a route, or remove one
+  struct RouteUpdate {
+    uint32_t route_prefix;
+    uint8_t prefix_length;
+    std::optional<Address> next_hop {};
+    size_t interface_num {};
+    bool remove = false;
+  };
+
+  // Apply a batch of changes (e.g. a route flap or a full table reload) and publish them
+  // together. The table is updated in place, never rebuilt, and route() keeps forwarding
+  // with the previous table until the new one is published.
+  void update_routes( const std::vector<RouteUpdate>& updates );
+
+  // Put a direct-mapped cache of `num_slots` destinations in front of the routing table,
+  // for traffic concentrated on a limited set of destinations
+  void enable_route_cache( size_t num_slots ) { route_cache_.emplace( num_slots ); }
+
+  // Route cache hits and misses so far, over the serial-mode cache and every parallel worker's own
+  uint64_t route_cache_hits() const;
+  uint64_t route_cache_misses() const;
+
+  // Forward with one persistent worker thread per interface (add the interfaces, and enable the
+  // route cache if wanted, first). Each call to route() then runs rounds of two phases until
+  // every received datagram has been forwarded: each worker drains its own interface and looks
+  // up routes (the routing table is shared; each worker has its own route cache), handing each
+  // datagram to the output interface's worker over a lock-free single-producer, single-consumer
+  // ring; then each worker drains the rings addressed to it and sends on its own interface.
+  // A datagram that finds its ring full waits for the next round. The interfaces must only be
+  // used by other threads between calls to route(). An exception thrown in a worker is rethrown by
+  // route() at the end of that round; the workers stay ready for the next call.
+  void enable_parallel( size_t ring_capacity = 256 );
+  void disable_parallel();
+
+  // Send ICMP Time Exceeded, Destination Unreachable (no route) and Fragmentation Needed errors
+  // back to the senders of datagrams the router drops, at most `rate_per_second` (in bursts of
+  // up to `burst`) per interface. Errors are never sent about ICMP errors, non-initial fragments,
+  // or datagrams from non-unicast sources, nor when the route back to the sender does not
+  // leave through the interface the datagram arrived on.
+  void enable_icmp_errors( uint64_t rate_per_second = 100, uint64_t burst = 10 );
+
+  uint64_t icmp_errors_sent() const;
+  uint64_t icmp_errors_rate_limited() const;
+
+  // Time has passed (refills the ICMP rate limits). In parallel mode, call between calls to route().
+  void tick( uint64_t ms_since_last_tick );
+
   // Route packets between the interfaces. For each interface, use the
   // maybe_receive() method to consume every incoming datagram and
   // send it on one of interfaces to the correct next hop. The router
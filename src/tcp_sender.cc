@@ -1,7 +1,9 @@
 #include "tcp_sender.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
 #include <random>
+#include <set>
 
 using namespace std;
 
@@ -25,21 +27,109 @@ optional<TCPSenderMessage> TCPSender::maybe_send()
   if (to_be_sent.size() == 0) {
     return std::nullopt;
   }
-  TCPSenderMessage next_message = to_be_sent.front();
+  TCPSenderMessage next_message = std::move(to_be_sent.front());
   to_be_sent.pop_front();
+  start_timer();
+  return next_message;
+}
+
+size_t TCPSender::drain( vector<TCPSenderMessage>& out, size_t max )
+{
+  size_t moved = 0;
+  for (; moved < max && !to_be_sent.empty(); moved++) {
+    out.push_back(std::move(to_be_sent.front()));
+    to_be_sent.pop_front();
+  }
+  if (moved > 0) {
+    start_timer();
+  }
+  return moved;
+}
+
+void TCPSender::start_timer()
+{
   // when a segment containing data is sent, if the timer is not working,
   // START it running 
   if (!timer_working) {
     timer_working = true;
     timer = 0;
   }
-  return next_message;
+}
+
+vector<pair<uint64_t, TCPSenderMessage>> TCPSender::split_segment( uint64_t abs, const TCPSenderMessage& msg ) const
+{
+  vector<pair<uint64_t, TCPSenderMessage>> pieces;
+  size_t offset = 0;
+  do {
+    size_t length = min(max_payload, msg.payload.size() - offset);
+    TCPSenderMessage piece;
+    piece.SYN = msg.SYN && offset == 0;                          // SYN stays with the first byte...
+    piece.FIN = msg.FIN && offset + length == msg.payload.size(); // ...and FIN with the last
+    uint64_t piece_abs = offset == 0 ? abs : abs + msg.SYN + offset;
+    piece.seqno = isn_.wrap(piece_abs, isn_);
+    piece.payload = msg.payload.substr(offset, length);          // a slice: nothing is copied
+    pieces.emplace_back(piece_abs, std::move(piece));
+    offset += length;
+  } while (offset < msg.payload.size());
+  return pieces;
+}
+
+void TCPSender::update_path_mtu( uint64_t path_mtu )
+{
+  uint64_t new_payload = max(path_mtu, MIN_PATH_MTU) - HEADERS_LENGTH;
+  if (new_payload >= max_payload) {   // only the network lowers it; raising is tick()'s job
+    return;
+  }
+  max_payload = new_payload;
+  pmtu_timer = 0;
+
+  // segments still in the queue never left, so they are split but not resent
+  set<uint64_t> unsent;
+  for (const auto& msg : to_be_sent) {
+    unsent.insert(msg.seqno.unwrap(isn_, next_absolute_seq));
+  }
+
+  // outstanding segments that went out too big were dropped on the way: resend them, in pieces
+  deque<TCPSenderMessage> resend;
+  map<uint64_t, TCPSenderMessage> split_outstandings;
+  for (const auto& [abs, msg] : outstandings) {
+    bool lost = msg.payload.size() > max_payload && !unsent.contains(abs);
+    for (auto& [piece_abs, piece] : split_segment(abs, msg)) {
+      if (lost) {
+        resend.push_back(piece);
+      }
+      split_outstandings.emplace(piece_abs, std::move(piece));
+    }
+  }
+  outstandings = std::move(split_outstandings);
+
+  for (const auto& msg : to_be_sent) {
+    for (auto& piece : split_segment(msg.seqno.unwrap(isn_, next_absolute_seq), msg)) {
+      resend.push_back(std::move(piece.second));
+    }
+  }
+  to_be_sent = std::move(resend);
+}
+
+void TCPSender::set_payload_ceiling( uint64_t max_payload_size )
+{
+  payload_ceiling = clamp(max_payload_size, MIN_PATH_MTU - HEADERS_LENGTH, TCPConfig::MAX_PAYLOAD_SIZE);
+  max_payload = min(max_payload, payload_ceiling);
 }
 
 void TCPSender::push( Reader& outbound_stream )
 {
   uint16_t curr_window_size = window_size == 0 ? 1 : window_size; // if the window size is zero, we pretend like it is one
   while (curr_window_size >= inflight_number) {
+    bool more_to_send = !syn_set || outbound_stream.bytes_buffered() > 0
+                        || (outbound_stream.is_finished() && !fin_set);
+    if (!more_to_send) {
+      break;
+    }
+    if (to_be_sent.size() >= max_queued) {   // the caller is not draining: leave the bytes in the stream
+      backpressure_stalls += 1;
+      break;
+    }
     TCPSenderMessage next;    // construct next segment waiting to be sent
     if (!syn_set) {           // should we set SYN value in this segment?
       next.SYN = true;
@@ -48,7 +138,7 @@ void TCPSender::push( Reader& outbound_stream )
     next.seqno = isn_.wrap(next_absolute_seq, isn_);      // wrap current sequence number
     // make individual message as big as possible
 
-    uint64_t payload_size_one = min(TCPConfig::MAX_PAYLOAD_SIZE, curr_window_size - inflight_number);   // the number can be sent
+    uint64_t payload_size_one = min(max_payload, curr_window_size - inflight_number);   // the number can be sent
     uint64_t payload_size = min(payload_size_one, outbound_stream.bytes_buffered());                    // the number can be read
     std::string next_payload;
     read(outbound_stream, payload_size, next_payload);
@@ -115,6 +205,13 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 
 void TCPSender::tick( const size_t ms_since_last_tick )
 {
+  if (max_payload < payload_ceiling) {   // the path may have grown since it was lowered: probe with the ceiling
+    pmtu_timer += ms_since_last_tick;
+    if (pmtu_timer >= PMTU_RAISE_INTERVAL_MS) {
+      max_payload = payload_ceiling;     // too big after all? the network says so again and we come back down
+      pmtu_timer = 0;
+    }
+  }
   if ( !timer_working ) {           // if the timer is not working, return immediately
     return;
   }
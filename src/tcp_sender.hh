@@ -1,11 +1,13 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include <cmath>
 #include <map>
 #include <queue>
+#include <vector>
 class TCPSender
 {
   Wrap32 isn_;                  // initial sequence number aka.sequence number for SYN
@@ -28,6 +30,22 @@ class TCPSender
   // index in the map is **absolute** sequence number
   std::map<uint64_t, TCPSenderMessage> outstandings{};   // keep track of outstanding segments
   std::deque<TCPSenderMessage> to_be_sent{};
+  // backpressure: push() makes no new segments while this many are waiting to be sent
+  static constexpr size_t DEFAULT_MAX_QUEUED = 1024;
+  size_t max_queued{DEFAULT_MAX_QUEUED};
+  uint64_t backpressure_stalls{0};  // push() calls cut short by a full queue
+  // path MTU discovery (RFC 1191): segments shrink when the network says they are too big,
+  // and every PMTU_RAISE_INTERVAL_MS the sender tries the ceiling again
+  static constexpr uint64_t HEADERS_LENGTH = 40;            // IPv4 and TCP headers, without options
+  static constexpr uint64_t MIN_PATH_MTU = 68;              // every IPv4 link carries this much
+  static constexpr uint64_t PMTU_RAISE_INTERVAL_MS = 600000;
+  uint64_t max_payload{TCPConfig::MAX_PAYLOAD_SIZE};        // payload bytes per segment on this path
+  uint64_t payload_ceiling{TCPConfig::MAX_PAYLOAD_SIZE};    // never more than this, whatever the path
+  uint64_t pmtu_timer{0};                                   // ms since max_payload was last lowered
+
+  void start_timer();             // segments are leaving: make sure the retransmission timer runs
+  // cut `msg` (at absolute seqno `abs`) into segments that fit max_payload, keyed by absolute seqno
+  std::vector<std::pair<uint64_t, TCPSenderMessage>> split_segment( uint64_t abs, const TCPSenderMessage& msg ) const;
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
   TCPSender( uint64_t initial_RTO_ms, std::optional<Wrap32> fixed_isn );
@@ -38,6 +56,19 @@ public:
   /* Send a TCPSenderMessage if needed (or empty optional otherwise) */
   std::optional<TCPSenderMessage> maybe_send();
 
+  /* Move up to `max` TCPSenderMessages onto the end of `out`; returns how many were moved */
+  size_t drain( std::vector<TCPSenderMessage>& out, size_t max );
+
+  /* Bound on segments waiting to be sent: push() stops making new ones while the queue is full */
+  void set_max_queued( size_t max_segments ) { max_queued = max_segments; }
+
+  /* The path MTU is `path_mtu` bytes (e.g. from an ICMP "fragmentation needed" message): shrink the
+     segments, splitting the queued and outstanding ones and resending those already sent too big */
+  void update_path_mtu( uint64_t path_mtu );
+
+  /* Largest payload to put in a segment even when the path allows more (at most MAX_PAYLOAD_SIZE) */
+  void set_payload_ceiling( uint64_t max_payload_size );
+
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage send_empty_message() const;
 
@@ -50,4 +81,7 @@ public:
   /* Accessors for use in testing */
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  size_t segments_queued() const { return to_be_sent.size(); }  // How many segments are waiting to be sent?
+  uint64_t backpressure_events() const { return backpressure_stalls; } // How often did push() stop at a full queue?
+  uint64_t max_payload_size() const { return max_payload; }   // Largest payload the sender currently puts in a segment
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// A token bucket: up to `capacity` tokens, refilled at `rate_per_second` by the owner's clock.
+//
+// Each permitted event takes one token, so events are allowed in bursts of up to `capacity`
+// and at `rate_per_second` on average. Fractions of a token carry over between refills.
+class TokenBucket
+{
+  uint64_t rate_per_second_;
+  uint64_t capacity_;
+  uint64_t tokens_;
+  uint64_t carry_ {}; // token-milliseconds accrued towards the next whole token
+  uint64_t taken_ {};
+  uint64_t refused_ {};
+
+public:
+  // A full bucket
+  TokenBucket( const uint64_t rate_per_second, const uint64_t capacity )
+    : rate_per_second_( rate_per_second ), capacity_( capacity ), tokens_( capacity )
+  {}
+
+  // Take a token if there is one
+  bool try_take()
+  {
+    if ( tokens_ == 0 ) {
+      ++refused_;
+      return false;
+    }
+    --tokens_;
+    ++taken_;
+    return true;
+  }
+
+  // Time has passed
+  void refill( const uint64_t ms_since_last_refill )
+  {
+    carry_ += ms_since_last_refill * rate_per_second_;
+    tokens_ = std::min( capacity_, tokens_ + carry_ / 1000 );
+    carry_ = tokens_ == capacity_ ? 0 : carry_ % 1000;
+  }
+
+  uint64_t tokens() const { return tokens_; }
+  uint64_t taken() const { return taken_; }
+  uint64_t refused() const { return refused_; }
+};
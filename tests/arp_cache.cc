@@ -0,0 +1,72 @@
+#include "arp_cache.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Drive an ARPCache and a plain map side by side with random learns, lookups and clock
+// advances, and check they always agree
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    uniform_int_distribution<uint32_t> address_dist { 0, 499 }; // small range, so addresses are re-learned
+    uniform_int_distribution<uint32_t> advance_dist { 0, 3000 };
+    uniform_int_distribution<int> action_dist { 0, 9 };
+
+    constexpr uint64_t lifetime = 30000;
+    ARPCache cache { lifetime };
+    map<uint32_t, pair<EthernetAddress, uint64_t>> reference; // address => (mapping, expiry)
+    uint64_t now = 0;
+
+    for ( unsigned int i = 0; i < 200000; i++ ) {
+      const uint32_t address = address_dist( rd ) * 0x01010101;
+      switch ( action_dist( rd ) ) {
+        case 0:
+        case 1:
+        case 2: {
+          EthernetAddress eth {};
+          for ( auto& b : eth ) {
+            b = static_cast<uint8_t>( rd() );
+          }
+          cache.learn( address, eth, now );
+          reference[address] = { eth, now + lifetime };
+          break;
+        }
+        case 3: {
+          // occasionally jump far ahead, past a whole turn of the timing wheel
+          now += i % 1000 == 0 ? 100000 : advance_dist( rd );
+          cache.expire( now );
+          erase_if( reference, [&]( const auto& mapping ) { return mapping.second.second <= now; } );
+          break;
+        }
+        default: {
+          const ARPCache::Entry* entry = cache.find( address );
+          const auto it = reference.find( address );
+          if ( ( entry != nullptr ) != ( it != reference.end() ) ) {
+            throw runtime_error( "ARPCache: presence of a mapping disagrees with the reference at t="
+                                 + to_string( now ) );
+          }
+          if ( entry and entry->ethernet_address != it->second.first ) {
+            throw runtime_error( "ARPCache: wrong Ethernet address" );
+          }
+          break;
+        }
+      }
+
+      if ( cache.size() != reference.size() ) {
+        throw runtime_error( "ARPCache: size " + to_string( cache.size() ) + " but expected "
+                             + to_string( reference.size() ) );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "buffer_pool.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// A pipe: { read end, write end }
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "pipe", ::pipe( fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // a read lands in a pooled block, and never takes more than a block
+    {
+      auto [in, out] = make_pipe();
+      const BufferPool pool { 64 };
+      const string data( 100, 'p' );
+      out.write( data );
+
+      Buffer first;
+      in.read( first, pool );
+      Buffer second;
+      in.read( second, pool );
+      if ( string_view { first } != string_view { data }.substr( 0, 64 )
+           or string_view { second } != string_view { data }.substr( 64 ) ) {
+        throw runtime_error( "pooled reads returned the wrong bytes" );
+      }
+      if ( in.read_count() != 2 ) {
+        throw runtime_error( "pooled reads were not registered" );
+      }
+    }
+
+    // a block is read into again only once every Buffer referring to it is gone
+    {
+      auto [in, out] = make_pipe();
+      const BufferPool pool;
+      out.write( "first" );
+      Buffer buffer;
+      in.read( buffer, pool );
+      const char* const block = string_view { buffer }.data();
+
+      Buffer copy = buffer;
+      out.write( "second" );
+      in.read( buffer, pool );
+      const char* const second_block = string_view { buffer }.data();
+      if ( string_view { buffer } != "second" or string_view { copy } != "first" or second_block == block ) {
+        throw runtime_error( "a block still in use was read into again" );
+      }
+
+      copy = Buffer {};
+      buffer = Buffer {};
+      out.write( "third" );
+      in.read( buffer, pool );
+      const char* const third_block = string_view { buffer }.data();
+      if ( string_view { buffer } != "third" or ( third_block != block and third_block != second_block ) ) {
+        throw runtime_error( "a released block was not reused" );
+      }
+    }
+
+    // nothing to read on a non-blocking descriptor, then end of file
+    {
+      auto [in, out] = make_pipe();
+      in.set_blocking( false );
+      const BufferPool pool;
+      Buffer buffer { "stale" };
+      in.read( buffer, pool );
+      if ( not buffer.empty() or in.read_count() != 0 or in.eof() ) {
+        throw runtime_error( "read with nothing available did not return an empty Buffer" );
+      }
+      out.close();
+      in.read( buffer, pool );
+      if ( not buffer.empty() or not in.eof() ) {
+        throw runtime_error( "read at end of file did not set eof" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include "byte_stream.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace {
+
+// A connected pair of non-blocking stream sockets, the first with a small send buffer
+pair<FileDescriptor, FileDescriptor> make_pair_of_sockets()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  FileDescriptor sender { fds[0] };
+  FileDescriptor receiver { fds[1] };
+  const int sndbuf = 4096;
+  CheckSystemCall( "setsockopt", ::setsockopt( sender.fd_num(), SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof( sndbuf ) ) );
+  sender.set_blocking( false );
+  receiver.set_blocking( false );
+  return { std::move( sender ), std::move( receiver ) };
+}
+
+// Everything the descriptor has to give right now
+string read_available( FileDescriptor& fd )
+{
+  string all;
+  string chunk;
+  do {
+    fd.read( chunk );
+    all += chunk;
+  } while ( not chunk.empty() );
+  return all;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // an empty stream writes nothing
+    {
+      auto [sender, receiver] = make_pair_of_sockets();
+      ByteStream stream { 100 };
+      if ( write_to( stream.reader(), sender ) != 0 or sender.write_count() != 0 ) {
+        throw runtime_error( "write_to wrote from an empty stream" );
+      }
+    }
+
+    // a descriptor that accepts only part of the buffered bytes: exactly those are popped
+    {
+      auto [sender, receiver] = make_pair_of_sockets();
+      string data( 1 << 20, 0 );
+      for ( size_t i = 0; i < data.size(); ++i ) {
+        data[i] = static_cast<char>( i * 7 + i / 251 );
+      }
+      ByteStream stream { data.size() };
+      stream.writer().push( data );
+
+      uint64_t written = write_to( stream.reader(), sender );
+      if ( written == 0 or written >= data.size() ) {
+        throw runtime_error( "expected a partial write, got " + to_string( written ) + " bytes" );
+      }
+      while ( const uint64_t more = write_to( stream.reader(), sender ) ) {
+        written += more;
+      }
+      if ( stream.reader().bytes_popped() != written or stream.reader().bytes_buffered() != data.size() - written ) {
+        throw runtime_error( "write_to popped a different number of bytes than it wrote" );
+      }
+
+      // the peer drains the socket; the rest goes out over later calls, in order
+      string received = read_available( receiver );
+      if ( received != data.substr( 0, written ) ) {
+        throw runtime_error( "peer received the wrong bytes after a partial write" );
+      }
+      while ( stream.reader().bytes_buffered() > 0 ) {
+        write_to( stream.reader(), sender );
+        received += read_available( receiver );
+      }
+      received += read_available( receiver );
+      if ( received != data ) {
+        throw runtime_error( "peer received the wrong bytes" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include "checksum.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Run every summing kernel this CPU supports directly, over random lengths and alignments (including
+// pieces that start halfway through a 16-bit word), and check each against the byte-at-a-time sum
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    string data( 8192, 0 );
+    for ( auto& c : data ) {
+      c = static_cast<char>( rd() );
+    }
+
+    uniform_int_distribution<size_t> offset_dist { 0, 63 };
+    uniform_int_distribution<size_t> length_dist { 0, 4096 };
+    uniform_int_distribution<size_t> split_dist { 0, 3 };
+
+    for ( const auto kernel : InternetChecksum::kernels() ) {
+      for ( unsigned int i = 0; i < 20000; i++ ) {
+        const size_t offset = offset_dist( rd );
+        const size_t length = i < 256 ? i : length_dist( rd );
+        const string_view piece = string_view { data }.substr( offset, length );
+
+        // an odd-length prefix leaves the kernel to sum the rest from an odd byte
+        const size_t split = min( split_dist( rd ), piece.size() );
+        InternetChecksum expected;
+        expected.add_scalar( piece );
+        InternetChecksum actual;
+        actual.add( piece.substr( 0, split ), kernel );
+        actual.add( piece.substr( split ), kernel );
+
+        if ( actual.value() != expected.value() ) {
+          throw runtime_error( "kernel " + string( kernel ) + " got the wrong sum for " + to_string( length )
+                               + " bytes at offset " + to_string( offset ) + " (split at " + to_string( split )
+                               + ")" );
+        }
+      }
+    }
+
+    bool rejected = false;
+    try {
+      InternetChecksum {}.add( data, "no such kernel" );
+    } catch ( const runtime_error& ) {
+      rejected = true;
+    }
+    if ( not rejected ) {
+      throw runtime_error( "an unknown kernel name was accepted" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
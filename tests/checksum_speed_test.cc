@@ -0,0 +1,115 @@
+#include "checksum.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace std;
+using namespace std::chrono;
+
+// Check the vectorized kernel against the byte-at-a-time reference, including odd lengths and splits
+void check_correctness( default_random_engine& rd )
+{
+  uniform_int_distribution<char> byte_dist;
+  uniform_int_distribution<size_t> len_dist { 0, 4000 };
+
+  for ( unsigned i = 0; i < 2000; ++i ) {
+    string data( len_dist( rd ), 0 );
+    for ( auto& ch : data ) {
+      ch = byte_dist( rd );
+    }
+
+    InternetChecksum reference;
+    reference.add_scalar( data );
+
+    InternetChecksum whole;
+    whole.add( data );
+
+    // add the same bytes in random pieces, so that pieces start and end on odd offsets
+    InternetChecksum pieces;
+    string_view remaining = data;
+    while ( not remaining.empty() ) {
+      const size_t n = uniform_int_distribution<size_t> { 1, remaining.size() }( rd );
+      pieces.add( remaining.substr( 0, n ) );
+      remaining.remove_prefix( n );
+    }
+
+    if ( whole.value() != reference.value() or pieces.value() != reference.value() ) {
+      throw runtime_error( "InternetChecksum::add disagrees with add_scalar for length "
+                           + to_string( data.size() ) );
+    }
+  }
+}
+
+template<class Add>
+double measure( const string& data, const unsigned reps, Add&& add, uint16_t& result )
+{
+  const auto start_time = steady_clock::now();
+  for ( unsigned i = 0; i < reps; ++i ) {
+    InternetChecksum cksum;
+    add( cksum, data );
+    result ^= cksum.value();
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  return 8 * static_cast<double>( data.size() ) * reps / test_duration.count() / 1e9;
+}
+
+void speed_test( const size_t input_len, const unsigned reps, default_random_engine& rd )
+{
+  uniform_int_distribution<char> byte_dist;
+  string data( input_len, 0 );
+  for ( auto& ch : data ) {
+    ch = byte_dist( rd );
+  }
+
+  uint16_t scalar_result = 0;
+  uint16_t fast_result = 0;
+  const double scalar_gbps = measure(
+    data, reps, []( InternetChecksum& c, const string& d ) { c.add_scalar( d ); }, scalar_result );
+  const double fast_gbps
+    = measure( data, reps, []( InternetChecksum& c, const string& d ) { c.add( d ); }, fast_result );
+
+  if ( scalar_result != fast_result ) {
+    throw runtime_error( "Mismatch between scalar and " + string( InternetChecksum::implementation() )
+                         + " checksums" );
+  }
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "InternetChecksum over " << input_len << "-byte buffers: scalar " << fixed << setprecision( 2 )
+       << scalar_gbps << " Gbit/s, " << InternetChecksum::implementation() << " " << fast_gbps << " Gbit/s.\n";
+
+  debug_output << "             InternetChecksum (" << InternetChecksum::implementation()
+               << ") throughput: " << fixed << setprecision( 2 ) << fast_gbps << " Gbit/s\n";
+
+  if ( fast_gbps < 1 ) {
+    throw runtime_error( "InternetChecksum did not meet minimum speed of 1 Gbit/s." );
+  }
+}
+
+void program_body()
+{
+  default_random_engine rd { 1623 };
+  check_correctness( rd );
+  speed_test( 20, 500000, rd );
+  speed_test( 1500, 20000, rd );
+  speed_test( 65536, 500, rd );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include "arp_message.hh"
+#include "checksum.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Reference encoders, written out field by field in network byte order
+
+void put( string& out, uint64_t val, size_t bytes )
+{
+  for ( size_t i = 0; i < bytes; i++ ) {
+    out.push_back( static_cast<char>( val >> ( ( bytes - i - 1 ) * 8 ) ) );
+  }
+}
+
+void put( string& out, const EthernetAddress& addr )
+{
+  for ( const auto b : addr ) {
+    out.push_back( static_cast<char>( b ) );
+  }
+}
+
+string reference( const IPv4Header& h )
+{
+  string out;
+  put( out, ( h.ver << 4 ) | ( h.hlen & 0xf ), 1 );
+  put( out, h.tos, 1 );
+  put( out, h.len, 2 );
+  put( out, h.id, 2 );
+  put( out, ( h.df ? 0x4000 : 0 ) | ( h.mf ? 0x2000 : 0 ) | ( h.offset & 0x1fff ), 2 );
+  put( out, h.ttl, 1 );
+  put( out, h.proto, 1 );
+  put( out, h.cksum, 2 );
+  put( out, h.src, 4 );
+  put( out, h.dst, 4 );
+  return out;
+}
+
+string reference( const EthernetHeader& h )
+{
+  string out;
+  put( out, h.dst );
+  put( out, h.src );
+  put( out, h.type, 2 );
+  return out;
+}
+
+string reference( const ARPMessage& m )
+{
+  string out;
+  put( out, m.hardware_type, 2 );
+  put( out, m.protocol_type, 2 );
+  put( out, m.hardware_address_size, 1 );
+  put( out, m.protocol_address_size, 1 );
+  put( out, m.opcode, 2 );
+  put( out, m.sender_ethernet_address );
+  put( out, m.sender_ip_address, 4 );
+  put( out, m.target_ethernet_address );
+  put( out, m.target_ip_address, 4 );
+  return out;
+}
+
+template<class T>
+string concat( const T& obj )
+{
+  string out;
+  for ( const auto& b : serialize( obj ) ) {
+    out.append( b );
+  }
+  return out;
+}
+
+// serialize() must match the reference encoding, and parse() must recover the same header
+template<class T>
+void check( const T& original, const string& name )
+{
+  const string expected = reference( original );
+  if ( concat( original ) != expected ) {
+    throw runtime_error( name + ": serialize() does not match the reference encoding" );
+  }
+
+  T parsed {};
+  if ( not parse( parsed, { Buffer { expected } } ) ) {
+    throw runtime_error( name + ": parse() failed on the reference encoding" );
+  }
+  if ( reference( parsed ) != expected ) {
+    throw runtime_error( name + ": parse() did not recover the original fields" );
+  }
+
+  // the same bytes split at every position must parse identically
+  for ( size_t split = 1; split < expected.size(); split++ ) {
+    T piecewise {};
+    if ( not parse( piecewise, { Buffer { expected.substr( 0, split ) }, Buffer { expected.substr( split ) } } )
+         or reference( piecewise ) != expected ) {
+      throw runtime_error( name + ": parse() of a split buffer did not recover the original fields" );
+    }
+  }
+}
+
+// Incremental checksum updates must agree with recomputing the checksum from scratch
+void check_incremental( IPv4Header ip, const uint32_t new_src, const uint32_t new_dst )
+{
+  ip.decrement_ttl();
+  ip.set_src( new_src );
+  ip.set_dst( new_dst );
+
+  IPv4Header recomputed = ip;
+  recomputed.compute_checksum();
+  if ( ip.cksum != recomputed.cksum ) {
+    throw runtime_error( "IPv4Header: incremental checksum update disagrees with compute_checksum()" );
+  }
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    uniform_int_distribution<uint32_t> dist32;
+    auto random_eth = [&] {
+      EthernetAddress addr {};
+      for ( auto& b : addr ) {
+        b = static_cast<uint8_t>( dist32( rd ) );
+      }
+      return addr;
+    };
+
+    for ( unsigned int i = 0; i < 1000; i++ ) {
+      IPv4Header ip;
+      ip.tos = dist32( rd );
+      ip.len = dist32( rd );
+      ip.id = dist32( rd );
+      ip.df = dist32( rd ) % 2;
+      ip.mf = dist32( rd ) % 2;
+      ip.offset = dist32( rd ) & 0x1fff;
+      ip.ttl = dist32( rd );
+      ip.proto = dist32( rd );
+      ip.src = dist32( rd );
+      ip.dst = dist32( rd );
+      ip.compute_checksum();
+      InternetChecksum over_image;
+      over_image.add( reference( ip ) );
+      if ( over_image.value() != 0 ) {
+        throw runtime_error( "IPv4Header: compute_checksum() does not match a checksum over the header bytes" );
+      }
+      check( ip, "IPv4Header" );
+      check_incremental( ip, dist32( rd ), dist32( rd ) );
+
+      EthernetHeader eth { random_eth(), random_eth(), static_cast<uint16_t>( dist32( rd ) ) };
+      check( eth, "EthernetHeader" );
+
+      ARPMessage arp;
+      arp.opcode = dist32( rd ) % 2 ? ARPMessage::OPCODE_REQUEST : ARPMessage::OPCODE_REPLY;
+      arp.sender_ethernet_address = random_eth();
+      arp.sender_ip_address = dist32( rd );
+      arp.target_ethernet_address = random_eth();
+      arp.target_ip_address = dist32( rd );
+      check( arp, "ARPMessage" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
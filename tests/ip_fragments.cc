@@ -0,0 +1,230 @@
+#include "ip_fragments.hh"
+#include "random.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+InternetDatagram make_datagram( uint16_t id, const string& payload, size_t pieces, default_random_engine& rd )
+{
+  InternetDatagram dgram;
+  dgram.header.src = 0x0a000001;
+  dgram.header.dst = 0x0a000002 + id % 3;
+  dgram.header.id = id;
+  dgram.header.proto = 17;
+  dgram.header.df = false;
+  dgram.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + payload.size() );
+  dgram.header.compute_checksum();
+
+  // split the payload over several Buffers, so fragments straddle them
+  uniform_int_distribution<size_t> cut_dist { 0, payload.size() };
+  vector<size_t> cuts { 0, payload.size() };
+  for ( size_t i = 1; i < pieces; i++ ) {
+    cuts.push_back( cut_dist( rd ) );
+  }
+  ranges::sort( cuts );
+  for ( size_t i = 0; i + 1 < cuts.size(); i++ ) {
+    if ( cuts[i] != cuts[i + 1] ) {
+      dgram.payload.emplace_back( payload.substr( cuts[i], cuts[i + 1] - cuts[i] ) );
+    }
+  }
+  return dgram;
+}
+
+string concat( const vector<Buffer>& buffers )
+{
+  string out;
+  for ( const auto& buf : buffers ) {
+    out.append( buf );
+  }
+  return out;
+}
+
+void check_fragments( const vector<InternetDatagram>& fragments, size_t mtu )
+{
+  for ( const auto& fragment : fragments ) {
+    const size_t length = concat( fragment.payload ).size();
+    if ( fragment.header.len > mtu or fragment.header.len != IPv4Header::LENGTH + length ) {
+      throw runtime_error( "fragment has the wrong length: " + fragment.header.to_string() );
+    }
+    if ( fragment.header.mf and length % 8 != 0 ) {
+      throw runtime_error( "non-final fragment payload is not a multiple of 8 bytes" );
+    }
+    IPv4Header header = fragment.header;
+    header.compute_checksum();
+    if ( header.cksum != fragment.header.cksum ) {
+      throw runtime_error( "fragment has a bad checksum" );
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // random datagrams, fragmented for random MTUs, arriving shuffled and with duplicates, interleaved
+    {
+      uniform_int_distribution<size_t> size_dist { 0, 9000 };
+      uniform_int_distribution<size_t> pieces_dist { 1, 6 };
+      const vector<size_t> mtus { 68, 576, 1006, 1280, 1500 };
+
+      DatagramReassembler reassembler;
+      for ( unsigned int round = 0; round < 200; round++ ) {
+        vector<string> payloads;
+        vector<InternetDatagram> fragments;
+        for ( uint16_t id = 0; id < 4; id++ ) {
+          string payload( size_dist( rd ), 0 );
+          ranges::generate( payload, [&] { return static_cast<char>( rd() ); } );
+          const size_t mtu = mtus.at( rd() % mtus.size() );
+
+          vector<InternetDatagram> these;
+          if ( not fragment_datagram( make_datagram( id, payload, pieces_dist( rd ), rd ), mtu, these ) ) {
+            throw runtime_error( "fragment_datagram refused a datagram without DF" );
+          }
+          check_fragments( these, mtu );
+          if ( these.size() > 1 ) {
+            fragments.push_back( these.at( rd() % these.size() ) ); // a duplicate
+          }
+          ranges::move( these, back_inserter( fragments ) );
+          payloads.push_back( std::move( payload ) );
+        }
+        ranges::shuffle( fragments, rd );
+
+        vector<bool> seen( payloads.size() );
+        for ( auto& fragment : fragments ) {
+          auto whole = reassembler.receive( std::move( fragment ) );
+          if ( not whole.has_value() ) {
+            continue;
+          }
+          const uint16_t id = whole->header.id;
+          if ( id >= payloads.size() or seen.at( id ) ) {
+            throw runtime_error( "reassembled an unexpected datagram" );
+          }
+          seen.at( id ) = true;
+          if ( concat( whole->payload ) != payloads.at( id ) ) {
+            throw runtime_error( "reassembled datagram has the wrong payload" );
+          }
+          if ( whole->header.mf or whole->header.offset != 0
+               or whole->header.len != IPv4Header::LENGTH + payloads.at( id ).size()
+               or whole->header.dst != 0x0a000002U + id % 3 ) {
+            throw runtime_error( "reassembled datagram has the wrong header: " + whole->header.to_string() );
+          }
+        }
+        if ( ranges::count( seen, false ) != 0 ) {
+          throw runtime_error( "not every datagram was reassembled" );
+        }
+
+        // a duplicate arriving after its datagram completed starts a bucket that can only time out
+        reassembler.tick( DatagramReassembler::Config {}.timeout_ms );
+        if ( reassembler.datagrams_pending() != 0 or reassembler.bytes_pending() != 0 ) {
+          throw runtime_error( "reassembler still holds data after the timeout" );
+        }
+      }
+    }
+
+    // a fragment can be fragmented again further along the path
+    {
+      const string payload( 4000, 'x' );
+      vector<InternetDatagram> first;
+      fragment_datagram( make_datagram( 7, payload, 2, rd ), 1500, first );
+      vector<InternetDatagram> second;
+      for ( auto& fragment : first ) {
+        fragment_datagram( std::move( fragment ), 576, second );
+      }
+      check_fragments( second, 576 );
+
+      DatagramReassembler reassembler;
+      optional<InternetDatagram> whole;
+      for ( auto& fragment : second ) {
+        whole = reassembler.receive( std::move( fragment ) );
+      }
+      if ( not whole.has_value() or concat( whole->payload ) != payload ) {
+        throw runtime_error( "twice-fragmented datagram was not reassembled" );
+      }
+    }
+
+    // DF is honored
+    {
+      InternetDatagram dgram = make_datagram( 1, string( 2000, 'y' ), 1, rd );
+      dgram.header.df = true;
+      vector<InternetDatagram> out;
+      if ( fragment_datagram( std::move( dgram ), 1500, out ) or not out.empty() ) {
+        throw runtime_error( "fragment_datagram fragmented a datagram with DF set" );
+      }
+    }
+
+    // a datagram whose payload disagrees with its header's length is refused, not mis-fragmented
+    {
+      InternetDatagram short_payload = make_datagram( 2, string( 2000, 'u' ), 2, rd );
+      short_payload.payload.pop_back();
+      InternetDatagram no_payload = make_datagram( 2, string( 2000, 'u' ), 1, rd );
+      no_payload.payload.clear();
+      vector<InternetDatagram> out;
+      if ( fragment_datagram( std::move( short_payload ), 1500, out )
+           or fragment_datagram( std::move( no_payload ), 1500, out ) or not out.empty() ) {
+        throw runtime_error( "fragment_datagram fragmented a datagram shorter than its header says" );
+      }
+    }
+
+    // incomplete datagrams time out
+    {
+      DatagramReassembler reassembler { { .max_bytes = 1 << 20, .max_datagrams = 16, .timeout_ms = 1000 } };
+      vector<InternetDatagram> fragments;
+      fragment_datagram( make_datagram( 3, string( 3000, 'z' ), 1, rd ), 1500, fragments );
+      reassembler.receive( std::move( fragments.front() ) );
+      reassembler.tick( 999 );
+      if ( reassembler.datagrams_pending() != 1 ) {
+        throw runtime_error( "incomplete datagram dropped too early" );
+      }
+      reassembler.tick( 1 );
+      if ( reassembler.datagrams_pending() != 0 or reassembler.bytes_pending() != 0
+           or reassembler.datagrams_dropped() != 1 ) {
+        throw runtime_error( "incomplete datagram did not time out" );
+      }
+    }
+
+    // memory is bounded: the oldest incomplete datagrams make way
+    {
+      DatagramReassembler reassembler { { .max_bytes = 10000, .max_datagrams = 4, .timeout_ms = 30000 } };
+      for ( uint16_t id = 0; id < 20; id++ ) {
+        vector<InternetDatagram> fragments;
+        fragment_datagram( make_datagram( id, string( 6000, 'w' ), 1, rd ), 1500, fragments );
+        fragments.pop_back(); // never complete
+        for ( auto& fragment : fragments ) {
+          reassembler.receive( std::move( fragment ) );
+        }
+        reassembler.tick( 1 );
+        if ( reassembler.bytes_pending() > 10000 or reassembler.datagrams_pending() > 4 ) {
+          throw runtime_error( "reassembler exceeded its limits" );
+        }
+      }
+      if ( reassembler.datagrams_dropped() == 0 ) {
+        throw runtime_error( "reassembler never evicted anything" );
+      }
+    }
+
+    // malformed fragments are refused
+    {
+      DatagramReassembler reassembler;
+      InternetDatagram dgram = make_datagram( 9, string( 13, 'v' ), 1, rd );
+      dgram.header.mf = true; // a non-final fragment must carry a multiple of 8 bytes
+      if ( reassembler.receive( std::move( dgram ) ).has_value() or reassembler.fragments_dropped() != 1 ) {
+        throw runtime_error( "malformed fragment was accepted" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "lpm_table.hh"
+#include "route_cache.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+struct Route
+{
+  uint32_t prefix;
+  uint8_t length;
+  uint32_t value;
+};
+
+// A random table shaped roughly like a full BGP table: mostly /24s, many /16-/23s, a few /8-/15s and
+// longer-than-/24 prefixes
+vector<Route> make_routes( const size_t num_routes, default_random_engine& rd )
+{
+  uniform_int_distribution<uint32_t> addr_dist;
+  uniform_int_distribution<uint32_t> value_dist { 0, 63 };
+  discrete_distribution<int> length_dist { { 2, 38, 55, 5 } };
+
+  vector<Route> routes;
+  routes.reserve( num_routes );
+  for ( size_t i = 0; i < num_routes; ++i ) {
+    uint8_t length = 0;
+    switch ( length_dist( rd ) ) {
+      case 0:
+        length = uniform_int_distribution<int> { 8, 15 }( rd );
+        break;
+      case 1:
+        length = uniform_int_distribution<int> { 16, 23 }( rd );
+        break;
+      case 2:
+        length = 24;
+        break;
+      default:
+        length = uniform_int_distribution<int> { 25, 32 }( rd );
+        break;
+    }
+    const uint32_t mask = length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+    routes.push_back( { addr_dist( rd ) & mask, length, value_dist( rd ) } );
+  }
+  return routes;
+}
+
+// Straightforward longest-prefix match: one hash lookup per prefix length, longest first
+class ReferenceTable
+{
+  array<unordered_map<uint32_t, uint32_t>, 33> by_length_ {};
+
+public:
+  void insert( const Route& route ) { by_length_.at( route.length )[route.prefix] = route.value; }
+  void erase( const Route& route ) { by_length_.at( route.length ).erase( route.prefix ); }
+
+  uint32_t lookup( const uint32_t address ) const
+  {
+    for ( int length = 32; length >= 0; --length ) {
+      const uint32_t mask = length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+      const auto& routes = by_length_.at( length );
+      const auto it = routes.find( address & mask );
+      if ( it != routes.end() ) {
+        return it->second;
+      }
+    }
+    return LPMTable::NO_ROUTE;
+  }
+};
+
+void speed_test( const size_t num_routes, const size_t num_lookups, default_random_engine& rd )
+{
+  const vector<Route> routes = make_routes( num_routes, rd );
+
+  const auto build_start = steady_clock::now();
+  LPMTable table;
+  for ( const auto& route : routes ) {
+    table.insert( route.prefix, route.length, route.value );
+  }
+  const auto build_stop = steady_clock::now();
+
+  // Destinations: half uniformly random, half inside a randomly chosen route
+  uniform_int_distribution<uint32_t> addr_dist;
+  uniform_int_distribution<size_t> route_dist { 0, routes.size() - 1 };
+  vector<uint32_t> destinations( num_lookups );
+  for ( size_t i = 0; i < destinations.size(); ++i ) {
+    const uint32_t random = addr_dist( rd );
+    if ( i % 2 ) {
+      const Route& route = routes[route_dist( rd )];
+      const uint32_t mask = route.length == 0 ? 0 : UINT32_MAX << ( 32 - route.length );
+      destinations[i] = route.prefix | ( random & ~mask );
+    } else {
+      destinations[i] = random;
+    }
+  }
+
+  // Check a sample against the reference
+  ReferenceTable reference;
+  for ( const auto& route : routes ) {
+    reference.insert( route );
+  }
+  auto check = [&]( const string& when ) {
+    for ( size_t i = 0; i < min<size_t>( destinations.size(), 100000 ); ++i ) {
+      if ( table.lookup( destinations[i] ) != reference.lookup( destinations[i] ) ) {
+        throw runtime_error( "LPMTable disagrees with the reference longest-prefix match " + when );
+      }
+    }
+  };
+  check( "after inserts" );
+
+  const auto start_time = steady_clock::now();
+  uint32_t checksum = 0;
+  for ( const auto dst : destinations ) {
+    checksum += table.lookup( dst );
+  }
+  const auto stop_time = steady_clock::now();
+
+  // Skewed traffic: 95% of datagrams go to a few thousand destinations, through a route cache
+  vector<uint32_t> hot( 4096 );
+  for ( auto& dst : hot ) {
+    dst = destinations[route_dist( rd ) % destinations.size()];
+  }
+  uniform_int_distribution<size_t> hot_dist { 0, hot.size() - 1 };
+  uniform_int_distribution<int> percent { 0, 99 };
+  vector<uint32_t> skewed( num_lookups );
+  for ( auto& dst : skewed ) {
+    dst = percent( rd ) < 95 ? hot[hot_dist( rd )] : addr_dist( rd );
+  }
+
+  RouteCache cache { 16384 };
+  const auto cache_start = steady_clock::now();
+  uint32_t cached_checksum = 0;
+  for ( const auto dst : skewed ) {
+    cached_checksum += cache.lookup( dst, 1, [&] { return table.lookup( dst ); } );
+  }
+  const auto cache_stop = steady_clock::now();
+
+  uint32_t uncached_checksum = 0;
+  for ( const auto dst : skewed ) {
+    uncached_checksum += table.lookup( dst );
+  }
+  if ( cached_checksum != uncached_checksum ) {
+    throw runtime_error( "RouteCache returned a different route than the LPMTable" );
+  }
+
+  // Withdraw a tenth of the routes in place and check again
+  const auto erase_start = steady_clock::now();
+  for ( size_t i = 0; i < routes.size(); i += 10 ) {
+    table.erase( routes[i].prefix, routes[i].length );
+  }
+  const auto erase_stop = steady_clock::now();
+  for ( size_t i = 0; i < routes.size(); i += 10 ) {
+    reference.erase( routes[i] );
+  }
+  check( "after erases" );
+
+  const auto build_duration = duration_cast<duration<double>>( build_stop - build_start );
+  const auto erase_duration = duration_cast<duration<double>>( erase_stop - erase_start );
+  const auto cache_duration = duration_cast<duration<double>>( cache_stop - cache_start );
+  const double cached_mlookups_per_second = static_cast<double>( num_lookups ) / cache_duration.count() / 1e6;
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const double mlookups_per_second = static_cast<double>( num_lookups ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "LPMTable with " << num_routes << " routes (built in " << fixed << setprecision( 2 )
+       << build_duration.count() << " s, " << table.memory_usage() / 1e6 << " MB) reached " << mlookups_per_second
+       << " million lookups/s (checksum " << checksum << "); withdrew " << ( routes.size() + 9 ) / 10
+       << " routes in " << erase_duration.count() << " s.\n";
+  cout << "  with skewed traffic and a " << cache.size() << "-slot route cache: " << cached_mlookups_per_second
+       << " million lookups/s (" << 100.0 * static_cast<double>( cache.hits() ) / num_lookups << "% hits).\n";
+
+  debug_output << "             LPMTable lookups (" << num_routes << " routes): " << fixed << setprecision( 2 )
+               << mlookups_per_second << " M/s\n";
+
+  if ( mlookups_per_second < 1 ) {
+    throw runtime_error( "LPMTable did not meet minimum speed of 1 million lookups/s." );
+  }
+}
+
+void program_body()
+{
+  default_random_engine rd { 2023 };
+  speed_test( 1000, 4'000'000, rd );
+  speed_test( 100'000, 4'000'000, rd );
+  speed_test( 900'000, 4'000'000, rd );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
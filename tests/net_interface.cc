@@ -320,6 +320,221 @@ int main()
         serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
       test.execute( ExpectNoFrame {} );
     }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth1 = random_private_ethernet_address();
+      const EthernetAddress remote_eth2 = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "pending datagrams are held per next hop", local_eth, Address( "10.0.0.1", 0 ) };
+
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.11" );
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.12" );
+
+      // two datagrams for the first next hop (only one ARP request), then one for the second
+      test.execute( SendDatagram { datagram, Address( "10.0.0.5", 0 ) } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.5", 0 ) } );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.19", 0 ) } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.19" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // the second next hop answers first: its datagram is not stuck behind the first's
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth2,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth2, "10.0.0.19", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth2, EthernetHeader::TYPE_IPv4, serialize( datagram3 ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // then the first, releasing both of its datagrams in order
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth1,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth1, "10.0.0.5", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth1, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth1, EthernetHeader::TYPE_IPv4, serialize( datagram2 ) ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "mappings in use are refreshed", local_eth, Address( "10.0.0.1", 0 ) };
+
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.5", {}, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "10.0.0.1", remote_eth, "10.0.0.5" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // close to expiry: the datagram still goes out, followed by a unicast refresh request
+      test.execute( Tick { 26000 } );
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.5", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    remote_eth,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // only one refresh request per mapping
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.11" );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.5", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram2 ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // the reply renews the mapping past the original 30 seconds
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.5", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute( Tick { 10000 } );
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.12" );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.5", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram3 ) ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "output queue is bounded and drains in batches", local_eth, Address( "10.0.0.1", 0 ) };
+      test.execute( SetMaxFramesOut { 3 } );
+
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.5", {}, "10.0.0.1" ) ) ),
+        {} } );
+      const auto reply = make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "10.0.0.1", remote_eth, "10.0.0.5" ) ) );
+
+      const auto datagram1 = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.11" );
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.12" );
+      test.execute( SendDatagram { datagram1, Address( "10.0.0.5", 0 ) } );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.5", 0 ) } );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.5", 0 ) } ); // the queue is full
+      test.execute( ExpectFramesDropped { 1 } );
+
+      test.execute( ExpectDrain {
+        2, { reply, make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram1 ) ) } } );
+      test.execute(
+        ExpectDrain { 8, { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram2 ) ) } } );
+      test.execute( ExpectDrain { 8, {} } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "datagrams over the MTU are fragmented and reassembled", local_eth, Address( "10.0.0.1", 0 ) };
+
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.5", {}, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "10.0.0.1", remote_eth, "10.0.0.5" ) ) ) } );
+
+      InternetDatagram big = make_datagram( "5.6.7.8", "13.12.11.10" );
+      big.payload = { Buffer { string( 1000, 'a' ) } };
+      big.header.df = false;
+      big.header.len = IPv4Header::LENGTH + 1000;
+      big.header.compute_checksum();
+      vector<InternetDatagram> fragments;
+      fragment_datagram( InternetDatagram { big }, 576, fragments );
+
+      test.execute( SetMTU { 576 } );
+      test.execute( SendDatagram { big, Address( "10.0.0.5", 0 ) } );
+      for ( const auto& fragment : fragments ) {
+        test.execute(
+          ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( fragment ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+
+      InternetDatagram big_df = big;
+      big_df.header.df = true;
+      big_df.header.compute_checksum();
+      test.execute( SendDatagram { big_df, Address( "10.0.0.5", 0 ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // arriving out of order, the fragments come up the stack as one datagram
+      test.execute( EnableReassembly {} );
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( fragments.back() ) ), {} } );
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( fragments.front() ) ), big } );
+    }
+
+    // a frame's shared header image does not outlive a change to its header
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.recv_frame( make_frame(
+        remote_eth,
+        local_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.5", local_eth, "10.0.0.1" ) ) ) );
+      iface.send_datagram( make_datagram( "10.0.0.1", "10.0.0.5" ), Address( "10.0.0.5", 0 ) );
+
+      optional<EthernetFrame> frame = iface.maybe_send();
+      if ( not frame.has_value() or frame->header_image() == nullptr ) {
+        throw runtime_error( "IPv4 frame to a known neighbor did not carry the header image" );
+      }
+      frame->header.dst = ETHERNET_BROADCAST;
+      EthernetFrame sent;
+      if ( frame->header_image() != nullptr or not parse( sent, serialize( *frame ) )
+           or sent.header != frame->header ) {
+        throw runtime_error( "frame was serialized with a stale header image" );
+      }
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return EXIT_FAILURE;
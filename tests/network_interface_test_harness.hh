@@ -135,6 +135,67 @@ struct Tick : public Action<NetworkInterface>
   explicit Tick( const size_t ms ) : _ms( ms ) {}
 };
 
+struct SetMaxFramesOut : public Action<NetworkInterface>
+{
+  size_t max_frames;
+
+  std::string description() const override { return "bound the output queue to " + to_string( max_frames ); }
+  void execute( NetworkInterface& interface ) const override { interface.set_max_frames_out( max_frames ); }
+
+  explicit SetMaxFramesOut( const size_t max ) : max_frames( max ) {}
+};
+
+struct SetMTU : public Action<NetworkInterface>
+{
+  size_t mtu;
+
+  std::string description() const override { return "set the MTU to " + to_string( mtu ); }
+  void execute( NetworkInterface& interface ) const override { interface.set_mtu( mtu ); }
+
+  explicit SetMTU( const size_t m ) : mtu( m ) {}
+};
+
+struct EnableReassembly : public Action<NetworkInterface>
+{
+  std::string description() const override { return "enable reassembly of fragments"; }
+  void execute( NetworkInterface& interface ) const override { interface.enable_reassembly(); }
+};
+
+struct ExpectFramesDropped : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "frames_dropped"; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.frames_dropped(); }
+};
+
+struct ExpectDrain : public Expectation<NetworkInterface>
+{
+  size_t max;
+  std::vector<EthernetFrame> expected;
+
+  std::string description() const override
+  {
+    return "drain( " + to_string( max ) + " ) moves out " + to_string( expected.size() ) + " frames";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    std::vector<EthernetFrame> frames;
+    const size_t moved = interface.drain( frames, max );
+    if ( moved != expected.size() or frames.size() != expected.size() ) {
+      throw ExpectationViolation( "NetworkInterface drained " + to_string( moved ) + " frames, but "
+                                  + to_string( expected.size() ) + " were expected" );
+    }
+    for ( size_t i = 0; i < frames.size(); ++i ) {
+      if ( not equal( frames[i], expected[i] ) ) {
+        throw ExpectationViolation( "NetworkInterface drained a different Ethernet frame than was expected: actual={"
+                                    + summary( frames[i] ) + "}" );
+      }
+    }
+  }
+
+  ExpectDrain( const size_t m, std::vector<EthernetFrame> e ) : max( m ), expected( std::move( e ) ) {}
+};
+
 inline std::string concat( std::vector<Buffer>& buffers )
 {
   return std::accumulate(
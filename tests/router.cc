@@ -1,5 +1,6 @@
 #include "router.hh"
 #include "arp_message.hh"
+#include "icmp_message.hh"
 #include "network_interface_test_harness.hh"
 #include "random.hh"
 
@@ -40,6 +41,33 @@ uint32_t ip( const string& str )
   return Address { str }.ipv4_numeric();
 }
 
+// The ICMP error a router interface at `from` should send about `offending`
+InternetDatagram icmp_error( const Address& from,
+                             const InternetDatagram& offending,
+                             const uint8_t type,
+                             const uint8_t code,
+                             const uint16_t next_hop_mtu = 0 )
+{
+  ICMPMessage icmp;
+  icmp.type = type;
+  icmp.code = code;
+  icmp.rest = next_hop_mtu;
+  icmp.payload = serialize( offending.header );
+  vector<Buffer> offending_payload = offending.payload;
+  const string quoted = concat( offending_payload ).substr( 0, ICMPMessage::QUOTED_PAYLOAD );
+  icmp.payload.emplace_back( quoted );
+  icmp.compute_checksum();
+
+  InternetDatagram dgram;
+  dgram.header.src = from.ipv4_numeric();
+  dgram.header.dst = offending.header.src;
+  dgram.header.proto = IPv4Header::PROTO_ICMP;
+  dgram.payload = serialize( icmp );
+  dgram.header.len = IPv4Header::LENGTH + ICMPMessage::HEADER_LENGTH + IPv4Header::LENGTH + quoted.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
 class Host
 {
   string _name;
@@ -227,6 +255,15 @@ public:
     }
   }
 
+  void enable_parallel()
+  {
+    _router.enable_route_cache( 64 ); // each worker gets its own
+    _router.enable_parallel();
+  }
+
+  Router& router() { return _router; }
+  size_t eth2() const { return eth2_id; }
+
   Host& host( const string& name )
   {
     auto it = _hosts.find( name );
@@ -240,14 +277,17 @@ public:
   }
 };
 
-void network_simulator()
+void network_simulator( const bool parallel )
 {
   const string green = "\033[32;1m";
   const string normal = "\033[m";
 
-  cerr << green << "Constructing network." << normal << "\n";
+  cerr << green << "Constructing network" << ( parallel ? " (parallel forwarding)." : "." ) << normal << "\n";
 
   Network network;
+  if ( parallel ) {
+    network.enable_parallel();
+  }
 
   cout << green << "\n\nTesting traffic between two ordinary hosts (applesauce to cherrypie)..." << normal
        << "\n\n";
@@ -314,6 +354,22 @@ void network_simulator()
     network.simulate();
   }
 
+  cout << green << "\n\nSuccess! Testing one burst bound for several interfaces..." << normal << "\n\n";
+  {
+    const vector<pair<string, string>> sends { { "143.195.131.17", "hs_router" },
+                                               { "1.2.3.4", "default_router" },
+                                               { "192.168.0.2", "cherrypie" },
+                                               { "143.195.131.18", "hs_router" },
+                                               { "8.8.8.8", "default_router" } };
+    for ( const auto& [destination, receiver] : sends ) {
+      auto dgram_sent = network.host( "applesauce" ).send_to( Address { destination } );
+      dgram_sent.header.ttl--;
+      dgram_sent.header.compute_checksum();
+      network.host( receiver ).expect( dgram_sent );
+    }
+    network.simulate();
+  }
+
   cout << green << "\n\nSuccess! Testing TTL expiration..." << normal << "\n\n";
   {
     auto dgram_sent = network.host( "applesauce" ).send_to( Address { "1.2.3.4" }, 1 );
@@ -323,13 +379,98 @@ void network_simulator()
     network.simulate();
   }
 
+  cout << green << "\n\nSuccess! Testing a route to a nonexistent interface..." << normal << "\n\n";
+  {
+    network.router().add_route( ip( "203.0.113.0" ), 24, {}, 99 );
+    network.host( "applesauce" ).send_to( Address { "203.0.113.7" } );
+    network.simulate();
+    if ( network.router().datagrams_misrouted() != 1 ) {
+      throw runtime_error( "datagram for a nonexistent interface was not dropped and counted" );
+    }
+    network.router().remove_route( ip( "203.0.113.0" ), 24 );
+  }
+
+  cout << green << "\n\nSuccess! Testing a rejected batch of route updates..." << normal << "\n\n";
+  {
+    bool rejected = false;
+    try {
+      network.router().update_routes( { { .route_prefix = ip( "1.0.0.0" ), .prefix_length = 8, .interface_num = 3 },
+                                        { .route_prefix = ip( "0.0.0.0" ), .prefix_length = 33 } } );
+    } catch ( const runtime_error& ) {
+      rejected = true;
+    }
+    if ( not rejected ) {
+      throw runtime_error( "update_routes accepted a /33" );
+    }
+
+    // nothing from the batch reached either copy of the table: both keep routing 1.2.3.4 to the default
+    for ( const auto* prefix : { "203.0.113.0", "203.0.114.0" } ) {
+      network.router().add_route( ip( prefix ), 24, {}, 99 );
+      auto dgram_sent = network.host( "applesauce" ).send_to( Address { "1.2.3.4" } );
+      dgram_sent.header.ttl--;
+      dgram_sent.header.compute_checksum();
+      network.host( "default_router" ).expect( dgram_sent );
+      network.simulate();
+    }
+    if ( network.router().remove_route( ip( "1.0.0.0" ), 8 ) ) {
+      throw runtime_error( "a route from a rejected batch was left in the table" );
+    }
+    network.router().remove_route( ip( "203.0.113.0" ), 24 );
+    network.router().remove_route( ip( "203.0.114.0" ), 24 );
+  }
+
+  cout << green << "\n\nSuccess! Testing ICMP errors..." << normal << "\n\n";
+  {
+    network.router().enable_icmp_errors( 1, 2 ); // one per second, in bursts of two
+    const Address eth0 { "10.0.0.1" };
+
+    auto dgram_sent = network.host( "applesauce" ).send_to( Address { "1.2.3.4" }, 1 );
+    network.host( "applesauce" )
+      .expect( icmp_error( eth0, dgram_sent, ICMPMessage::TYPE_TIME_EXCEEDED, ICMPMessage::CODE_TTL_EXCEEDED ) );
+    network.simulate();
+
+    network.router().interface( network.eth2() ).set_mtu( 30 );
+    dgram_sent = network.host( "applesauce" ).send_to( network.host( "cherrypie" ).address() );
+    network.host( "applesauce" )
+      .expect( icmp_error( eth0,
+                           dgram_sent,
+                           ICMPMessage::TYPE_DESTINATION_UNREACHABLE,
+                           ICMPMessage::CODE_FRAGMENTATION_NEEDED,
+                           30 ) );
+    network.simulate();
+    network.router().interface( network.eth2() ).set_mtu( 1500 );
+
+    // the bucket is empty: this one goes unreported, until time passes
+    network.router().remove_route( ip( "0.0.0.0" ), 0 );
+    network.host( "applesauce" ).send_to( Address { "1.2.3.4" } );
+    network.simulate();
+    if ( network.router().icmp_errors_rate_limited() != 1 ) {
+      throw runtime_error( "ICMP error was not rate-limited" );
+    }
+
+    network.router().tick( 1000 );
+    dgram_sent = network.host( "applesauce" ).send_to( Address { "1.2.3.4" } );
+    network.host( "applesauce" )
+      .expect( icmp_error(
+        eth0, dgram_sent, ICMPMessage::TYPE_DESTINATION_UNREACHABLE, ICMPMessage::CODE_NET_UNREACHABLE ) );
+    network.simulate();
+    if ( network.router().icmp_errors_sent() != 3 ) {
+      throw runtime_error( "unexpected number of ICMP errors sent" );
+    }
+  }
+
+  if ( parallel and network.router().route_cache_misses() == 0 ) {
+    throw runtime_error( "route cache counters did not include the workers' caches" );
+  }
+
   cout << "\n\n\033[32;1mCongratulations! All datagrams were routed successfully.\033[m\n";
 }
 
 int main()
 {
   try {
-    network_simulator();
+    network_simulator( false );
+    network_simulator( true );
   } catch ( const exception& e ) {
     cerr << "\n\n\n";
     cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
@@ -529,6 +529,97 @@ int main()
       test.execute( ExpectSeqnosInFlight { 0 } );
       test.execute( ExpectSeqno { isn + 2 + bigstring.size() } );
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      const string data( 5 * TCPConfig::MAX_PAYLOAD_SIZE, 'x' );
+
+      TCPSenderTestHarness test { "A full output queue holds back new segments", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 65535 ) );
+      test.execute( SetMaxQueued { 2 } );
+      test.execute( Push { data } );
+      test.execute( ExpectSegmentsQueued { 2 } );
+      test.execute( ExpectBackpressureEvents { 1 } );
+      test.execute( ExpectSeqnosInFlight { 2 * TCPConfig::MAX_PAYLOAD_SIZE } );
+      test.execute( ExpectDrain { 8, 2 } );
+      test.execute( Push {} );
+      test.execute( ExpectBackpressureEvents { 2 } );
+      test.execute( ExpectSeqnosInFlight { 4 * TCPConfig::MAX_PAYLOAD_SIZE } );
+      test.execute( ExpectDrain { 1, 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ).with_seqno( isn + 3001 ) );
+      test.execute( Push {} );
+      test.execute( ExpectSegmentsQueued { 1 } );
+      test.execute( ExpectBackpressureEvents { 2 } );
+      test.execute( ExpectSeqnosInFlight { data.size() } );
+      test.execute( ExpectMessage {}.with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ).with_seqno( isn + 4001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      const string data( 2 * TCPConfig::MAX_PAYLOAD_SIZE, 'x' );
+
+      TCPSenderTestHarness test { "Segments shrink to the path MTU and grow back later", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 65535 ) );
+      test.execute( Push { data } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectSegmentsQueued { 1 } );
+      test.execute( UpdatePathMTU { 1500 } ); // no news: segments never grow this way
+      test.execute( ExpectMaxPayload { TCPConfig::MAX_PAYLOAD_SIZE } );
+      test.execute( UpdatePathMTU { 576 } );
+      test.execute( ExpectMaxPayload { 536 } );
+      // the segment already sent is resent in pieces, then the queued one goes out split
+      test.execute( ExpectMessage {}.with_payload_size( 536 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 464 ).with_seqno( isn + 537 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 536 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 464 ).with_seqno( isn + 1537 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 2000 } );
+      test.execute( AckReceived { Wrap32 { isn + 537 } }.with_win( 65535 ) );
+      test.execute( ExpectSeqnosInFlight { 1464 } );
+      test.execute( Tick { 1000 } ); // the oldest piece is retransmitted alone
+      test.execute( ExpectMessage {}.with_payload_size( 464 ).with_seqno( isn + 537 ) );
+      test.execute( AckReceived { Wrap32 { isn + 2001 } }.with_win( 65535 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( Push { string( 1000, 'y' ) }.with_close() );
+      test.execute( ExpectMessage {}.with_payload_size( 536 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 464 ).with_fin( true ).with_seqno( isn + 2537 ) );
+      test.execute( AckReceived { Wrap32 { isn + 3002 } }.with_win( 65535 ) );
+      test.execute( Tick { 600000 - 1001 } );
+      test.execute( ExpectMaxPayload { 536 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMaxPayload { TCPConfig::MAX_PAYLOAD_SIZE } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "A split segment keeps FIN on its last piece", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 65535 ) );
+      test.execute( Push { string( 700, 'z' ) }.with_close() );
+      test.execute( UpdatePathMTU { 20 } ); // below the IPv4 minimum: 68 is assumed
+      test.execute( ExpectMaxPayload { 28 } );
+      for ( unsigned int i = 0; i < 24; i++ ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 28 ).with_seqno( isn + 1 + 28 * i ) );
+      }
+      test.execute( ExpectMessage {}.with_fin( true ).with_payload_size( 28 ).with_seqno( isn + 1 + 28 * 24 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 701 } );
+      test.execute( AckReceived { Wrap32 { isn + 702 } }.with_win( 65535 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return 1;
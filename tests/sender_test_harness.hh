@@ -66,6 +66,65 @@ struct ExpectNoSegment : public Expectation<StreamAndSender>
   }
 };
 
+struct ExpectSegmentsQueued : public ExpectNumber<StreamAndSender, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "segments_queued"; }
+  size_t value( StreamAndSender& ss ) const override { return ss.second.segments_queued(); }
+};
+
+struct ExpectBackpressureEvents : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "backpressure_events"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.backpressure_events(); }
+};
+
+struct SetMaxQueued : public Action<StreamAndSender>
+{
+  size_t max_segments_;
+
+  explicit SetMaxQueued( size_t max_segments ) : max_segments_( max_segments ) {}
+  std::string description() const override { return "bound the queue to " + std::to_string( max_segments_ ); }
+  void execute( StreamAndSender& ss ) const override { ss.second.set_max_queued( max_segments_ ); }
+};
+
+struct UpdatePathMTU : public Action<StreamAndSender>
+{
+  uint64_t path_mtu_;
+
+  explicit UpdatePathMTU( uint64_t path_mtu ) : path_mtu_( path_mtu ) {}
+  std::string description() const override { return "path MTU is " + std::to_string( path_mtu_ ); }
+  void execute( StreamAndSender& ss ) const override { ss.second.update_path_mtu( path_mtu_ ); }
+};
+
+struct ExpectMaxPayload : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "max_payload_size"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.max_payload_size(); }
+};
+
+struct ExpectDrain : public Expectation<StreamAndSender>
+{
+  size_t max_;
+  size_t expected_;
+
+  ExpectDrain( size_t max, size_t expected ) : max_( max ), expected_( expected ) {}
+  std::string description() const override
+  {
+    return "drain( " + std::to_string( max_ ) + " ) moves out " + std::to_string( expected_ ) + " segments";
+  }
+  void execute( StreamAndSender& ss ) const override
+  {
+    std::vector<TCPSenderMessage> segments;
+    const size_t moved = ss.second.drain( segments, max_ );
+    if ( moved != expected_ or segments.size() != expected_ ) {
+      throw ExpectationViolation( "segments drained", expected_, moved );
+    }
+  }
+};
+
 struct Push : public Action<StreamAndSender>
 {
   std::string data_;
@@ -0,0 +1,163 @@
+#include "socket.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // a datagram too big for its payload is marked truncated, and the rest of the batch still arrives
+    {
+      UDPSocket receiver;
+      receiver.bind( Address { "127.0.0.1" } );
+      UDPSocket sender;
+      const vector<string> sent { string( 10, 'a' ), string( 20000, 'b' ), string( 30, 'c' ) };
+      for ( const auto& payload : sent ) {
+        sender.sendto( receiver.local_address(), payload );
+      }
+
+      vector<DatagramSocket::ReceivedDatagram> received( 4 );
+      if ( receiver.recv_batch( received ) != 3 ) {
+        throw runtime_error( "recv_batch did not return every queued datagram" );
+      }
+      if ( received[0].truncated or received[0].contents() != sent[0] or received[2].truncated
+           or received[2].contents() != sent[2] ) {
+        throw runtime_error( "datagrams around a truncated one were not received intact" );
+      }
+      if ( not received[1].truncated or received[1].length == 0
+           or received[1].contents() != sent[1].substr( 0, received[1].length ) ) {
+        throw runtime_error( "oversized datagram was not marked truncated" );
+      }
+      if ( received[0].source_address().port() != sender.local_address().port() ) {
+        throw runtime_error( "recv_batch reported the wrong source address" );
+      }
+      if ( receiver.read_count() != 1 ) {
+        throw runtime_error( "recv_batch did not register the read" );
+      }
+
+      // a later call reads into the same storage, left at full size
+      const char* const storage = received[0].payload.data();
+      sender.sendto( receiver.local_address(), "again" );
+      if ( receiver.recv_batch( received ) != 1 or received[0].contents() != "again"
+           or received[0].payload.data() != storage or received[0].payload.size() < 16384 ) {
+        throw runtime_error( "recv_batch did not reuse a datagram's storage" );
+      }
+    }
+
+    // sendto_batch() and send_batch() send several datagrams each; recv_batch() receives them in order
+    {
+      UDPSocket receiver;
+      receiver.bind( Address { "127.0.0.1" } );
+      UDPSocket sender;
+      sender.bind( Address { "127.0.0.1" } );
+
+      const vector<string> first { "one", "two", "three" };
+      const vector<string> second { "four", string( 1500, 'x' ) };
+      if ( sender.sendto_batch( receiver.local_address(), { first.begin(), first.end() } ) != first.size() ) {
+        throw runtime_error( "sendto_batch did not send every datagram" );
+      }
+      sender.connect( receiver.local_address() );
+      if ( sender.send_batch( { second.begin(), second.end() } ) != second.size() ) {
+        throw runtime_error( "send_batch did not send every datagram" );
+      }
+      if ( sender.write_count() != 2 ) {
+        throw runtime_error( "batch sends did not register one write each" );
+      }
+
+      vector<string> expected = first;
+      expected.insert( expected.end(), second.begin(), second.end() );
+      vector<DatagramSocket::ReceivedDatagram> received( 8 );
+      size_t count = 0;
+      while ( count < expected.size() ) {
+        vector<DatagramSocket::ReceivedDatagram> batch( received.size() - count );
+        const size_t n = receiver.recv_batch( batch );
+        for ( size_t i = 0; i < n; ++i ) {
+          received[count++] = std::move( batch[i] );
+        }
+      }
+      for ( size_t i = 0; i < expected.size(); ++i ) {
+        if ( received[i].contents() != expected[i] or received[i].truncated or received[i].gro_segment_size != 0
+             or received[i].source_address() != sender.local_address() ) {
+          throw runtime_error( "recv_batch returned the wrong datagram at position " + to_string( i ) );
+        }
+      }
+    }
+
+    // with UDP_SEGMENT the kernel splits a send into segment-sized datagrams, and a receiver with
+    // UDP_GRO gets them back coalesced, with the segment size reported (skipped where unsupported)
+    {
+      UDPSocket receiver;
+      receiver.bind( Address { "127.0.0.1" } );
+      UDPSocket sender;
+      bool supported = true;
+      try {
+        sender.set_gso_segment_size( 100 );
+      } catch ( const exception& e ) {
+        cerr << "UDP_SEGMENT is not supported here (" << e.what() << "); skipping\n";
+        supported = false;
+      }
+
+      if ( supported ) {
+        const string payload( 1000, 'g' );
+        sender.sendto( receiver.local_address(), payload );
+        vector<DatagramSocket::ReceivedDatagram> received( 16 );
+        size_t count = 0;
+        while ( count < 10 ) {
+          vector<DatagramSocket::ReceivedDatagram> batch( 16 );
+          const size_t n = receiver.recv_batch( batch );
+          for ( size_t i = 0; i < n; ++i ) {
+            if ( batch[i].contents() != payload.substr( 0, 100 ) or batch[i].gro_segment_size != 0 ) {
+              throw runtime_error( "UDP_SEGMENT send did not arrive as 100-byte datagrams" );
+            }
+          }
+          count += n;
+        }
+        if ( count != 10 ) {
+          throw runtime_error( "UDP_SEGMENT send arrived as the wrong number of datagrams" );
+        }
+
+        bool gro = true;
+        try {
+          receiver.set_gro( true );
+        } catch ( const exception& e ) {
+          cerr << "UDP_GRO is not supported here (" << e.what() << "); skipping\n";
+          gro = false;
+        }
+        if ( gro ) {
+          sender.sendto( receiver.local_address(), payload );
+          size_t bytes = 0;
+          bool coalesced = false;
+          while ( bytes < payload.size() ) {
+            const size_t n = receiver.recv_batch( received );
+            for ( size_t i = 0; i < n; ++i ) {
+              const auto& dgram = received[i];
+              if ( dgram.length > 100 and dgram.gro_segment_size != 100 ) {
+                throw runtime_error( "coalesced datagram did not report its segment size" );
+              }
+              coalesced = coalesced or dgram.length > 100;
+              bytes += dgram.length;
+            }
+          }
+          if ( bytes != payload.size() or not coalesced ) {
+            throw runtime_error( "UDP_GRO receive did not return the segments coalesced" );
+          }
+        }
+
+        sender.set_gso_segment_size( 0 );
+        sender.sendto( receiver.local_address(), payload );
+        if ( receiver.recv_batch( received ) != 1 or received[0].contents() != payload ) {
+          throw runtime_error( "a segment size of zero did not turn UDP_SEGMENT off" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
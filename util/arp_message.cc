@@ -1,4 +1,5 @@
 #include "arp_message.hh"
+#include "header_codec.hh"
 
 #include <arpa/inet.h>
 #include <iomanip>
@@ -30,30 +31,26 @@ string ARPMessage::to_string() const
   return ss.str();
 }
 
+// Wire layout of an Ethernet/IPv4 ARP message
+using ARPLayout = HeaderLayout<ARPMessage,
+                               ARPMessage::LENGTH,
+                               Field<0, 16, &ARPMessage::hardware_type>,
+                               Field<16, 16, &ARPMessage::protocol_type>,
+                               Field<32, 8, &ARPMessage::hardware_address_size>,
+                               Field<40, 8, &ARPMessage::protocol_address_size>,
+                               Field<48, 16, &ARPMessage::opcode>,
+                               Field<64, 48, &ARPMessage::sender_ethernet_address>,
+                               Field<112, 32, &ARPMessage::sender_ip_address>,
+                               Field<144, 48, &ARPMessage::target_ethernet_address>,
+                               Field<192, 32, &ARPMessage::target_ip_address>>;
+
 void ARPMessage::parse( Parser& parser )
 {
-  parser.integer( hardware_type );
-  parser.integer( protocol_type );
-  parser.integer( hardware_address_size );
-  parser.integer( protocol_address_size );
-  parser.integer( opcode );
+  ARPLayout::parse( parser, *this );
 
   if ( not supported() ) {
     parser.set_error();
-    return;
-  }
-
-  // read sender addresses (Ethernet and IP)
-  for ( auto& b : sender_ethernet_address ) {
-    parser.integer( b );
-  }
-  parser.integer( sender_ip_address );
-
-  // read target addresses (Ethernet and IP)
-  for ( auto& b : target_ethernet_address ) {
-    parser.integer( b );
   }
-  parser.integer( target_ip_address );
 }
 
 void ARPMessage::serialize( Serializer& serializer ) const
@@ -62,21 +59,5 @@ void ARPMessage::serialize( Serializer& serializer ) const
     throw runtime_error( "ARPMessage: unsupported field combination (must be Ethernet/IP, and request or reply)" );
   }
 
-  serializer.integer( hardware_type );
-  serializer.integer( protocol_type );
-  serializer.integer( hardware_address_size );
-  serializer.integer( protocol_address_size );
-  serializer.integer( opcode );
-
-  // read sender addresses (Ethernet and IP)
-  for ( const auto& b : sender_ethernet_address ) {
-    serializer.integer( b );
-  }
-  serializer.integer( sender_ip_address );
-
-  // read target addresses (Ethernet and IP)
-  for ( const auto& b : target_ethernet_address ) {
-    serializer.integer( b );
-  }
-  serializer.integer( target_ip_address );
+  ARPLayout::serialize( *this, serializer );
 }
@@ -0,0 +1,123 @@
+#include "buffer.hh"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Each thread keeps the blocks its Buffers have released, split by how much
+// capacity they hold, so that reads can reuse large blocks while short strings
+// (which bring their own allocation) reuse small ones.
+struct Arena
+{
+  static constexpr size_t LARGE_CAPACITY = 2048;       // blocks at least this big are kept for reads
+  static constexpr size_t MAX_RETAINED_CAPACITY = 65536; // bigger allocations go back to the allocator
+  static constexpr size_t MAX_FREE_BLOCKS = 256;       // per size class
+
+  vector<Buffer::Block*> small {};
+  vector<Buffer::Block*> large {};
+
+  Arena() = default;
+  Arena( const Arena& other ) = delete;
+  Arena& operator=( const Arena& other ) = delete;
+  Arena( Arena&& other ) = delete;
+  Arena& operator=( Arena&& other ) = delete;
+  ~Arena();
+};
+
+thread_local Arena arena;
+thread_local bool arena_destroyed = false; // Buffers can outlive the arena (e.g. in static objects)
+
+Arena::~Arena()
+{
+  for ( auto* block : small ) {
+    delete block; // NOLINT(*-owning-memory)
+  }
+  for ( auto* block : large ) {
+    delete block; // NOLINT(*-owning-memory)
+  }
+  arena_destroyed = true;
+}
+
+} // namespace
+
+Buffer::Block* Buffer::allocate( size_t min_capacity )
+{
+  if ( not arena_destroyed ) {
+    auto& free_list = min_capacity >= Arena::LARGE_CAPACITY ? arena.large : arena.small;
+    if ( not free_list.empty() ) {
+      Block* block = free_list.back();
+      free_list.pop_back();
+      return block;
+    }
+  }
+  return new Block; // NOLINT(*-owning-memory)
+}
+
+void Buffer::recycle( Block* block )
+{
+  if ( arena_destroyed or block->data.capacity() > Arena::MAX_RETAINED_CAPACITY ) {
+    delete block; // NOLINT(*-owning-memory)
+    return;
+  }
+
+  auto& free_list = block->data.capacity() >= Arena::LARGE_CAPACITY ? arena.large : arena.small;
+  if ( free_list.size() >= Arena::MAX_FREE_BLOCKS ) {
+    delete block; // NOLINT(*-owning-memory)
+    return;
+  }
+
+  block->data.clear();
+  free_list.push_back( block );
+}
+
+Buffer Buffer::with_size( size_t size )
+{
+  Buffer ret;
+  ret.block_ = allocate( size );
+  ret.block_->data.resize( size );
+  ret.block_->refcount.store( 1, memory_order_relaxed );
+  return ret;
+}
+
+Buffer Buffer::substr( size_t pos, size_t len ) const
+{
+  const size_t total = size();
+  if ( pos > total ) {
+    throw out_of_range( "Buffer::substr: position beyond end of buffer" );
+  }
+  len = min( len, total - pos );
+
+  Buffer ret { *this };
+  if ( pos == 0 and len == total ) {
+    return ret; // the whole view: keep tracking the block as it is
+  }
+  ret.offset_ += pos;
+  ret.length_ = len;
+  return ret;
+}
+
+string& Buffer::unshare()
+{
+  if ( not block_ ) {
+    block_ = allocate( 0 );
+    block_->refcount.store( 1, memory_order_relaxed );
+    return block_->data;
+  }
+
+  const bool whole = ( offset_ == 0 and length_ == WHOLE );
+  if ( block_->refcount.load( memory_order_acquire ) == 1 and whole ) {
+    return block_->data;
+  }
+
+  Block* copy = allocate( size() );
+  copy->data.assign( string_view { *this } );
+  copy->refcount.store( 1, memory_order_relaxed );
+  unref();
+  block_ = copy;
+  offset_ = 0;
+  length_ = WHOLE;
+  return block_->data;
+}
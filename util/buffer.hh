@@ -1,23 +1,127 @@
 #pragma once
 
-#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 
+// A reference-counted, sliceable handle to an immutable-by-default string.
+//
+// Copies and slices of a Buffer share one block of storage. Blocks come from a
+// per-thread arena that recycles them (keeping their capacity) when the last
+// reference goes away, into the arena of whichever thread that happens on. The
+// reference count is atomic, so copies of a Buffer may be held, copied and destroyed
+// on different threads (e.g. datagrams parsed from one frame and forwarded by
+// different Router workers); each Buffer object itself is used by one thread at a time.
+//
+// Mutable access (the std::string& conversion, or release()) first gives the
+// Buffer a private copy of its bytes if the storage is shared or sliced.
 class Buffer
 {
-  std::shared_ptr<std::string> buffer_;
+public:
+  struct Block
+  {
+    std::string data {};
+    std::atomic<uint32_t> refcount {};
+  };
+
+private:
+  static constexpr size_t WHOLE = std::string::npos;
+
+  Block* block_ {};         // null for an empty Buffer that has never been written
+  size_t offset_ {};        // start of this Buffer's view within the block
+  size_t length_ { WHOLE }; // length of the view (WHOLE: the entire block, tracking its size)
+
+  static Block* allocate( size_t min_capacity ); // from this thread's arena
+  static void recycle( Block* block );           // back to this thread's arena
+
+  void retain() const
+  {
+    if ( block_ ) {
+      block_->refcount.fetch_add( 1, std::memory_order_relaxed );
+    }
+  }
+
+  void unref()
+  {
+    if ( block_ and block_->refcount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+      recycle( block_ );
+    }
+    block_ = nullptr;
+  }
+
+  // Make the block private to this Buffer and covering exactly its view
+  std::string& unshare();
 
 public:
   // NOLINTBEGIN(*-explicit-*)
 
-  Buffer( std::string str = {} ) : buffer_( make_shared<std::string>( std::move( str ) ) ) {}
-  operator std::string_view() const { return *buffer_; }
-  operator std::string&() { return *buffer_; }
+  Buffer( std::string str = {} )
+  {
+    if ( not str.empty() ) {
+      block_ = allocate( 0 );
+      block_->data = std::move( str );
+      block_->refcount.store( 1, std::memory_order_relaxed );
+    }
+  }
+  operator std::string_view() const
+  {
+    return block_ ? std::string_view { block_->data.data() + offset_, size() } : std::string_view {};
+  }
+  operator std::string&() { return unshare(); }
 
   // NOLINTEND(*-explicit-*)
 
-  std::string&& release() { return std::move( *buffer_ ); }
-  size_t size() const { return buffer_->size(); }
-  size_t length() const { return buffer_->length(); }
-  bool empty() const { return buffer_->empty(); }
+  // A Buffer of `size` bytes whose block has recycled capacity when the arena has any to spare
+  static Buffer with_size( size_t size );
+
+  Buffer( const Buffer& other ) : block_( other.block_ ), offset_( other.offset_ ), length_( other.length_ )
+  {
+    retain();
+  }
+
+  Buffer( Buffer&& other ) noexcept
+    : block_( std::exchange( other.block_, nullptr ) ), offset_( other.offset_ ), length_( other.length_ )
+  {}
+
+  Buffer& operator=( const Buffer& other )
+  {
+    if ( this != &other ) {
+      other.retain();
+      unref();
+      block_ = other.block_;
+      offset_ = other.offset_;
+      length_ = other.length_;
+    }
+    return *this;
+  }
+
+  Buffer& operator=( Buffer&& other ) noexcept
+  {
+    if ( this != &other ) {
+      unref();
+      block_ = std::exchange( other.block_, nullptr );
+      offset_ = other.offset_;
+      length_ = other.length_;
+    }
+    return *this;
+  }
+
+  ~Buffer() { unref(); }
+
+  // A view of `len` bytes starting at `pos` that shares this Buffer's storage (no copy)
+  Buffer substr( size_t pos, size_t len = std::string::npos ) const;
+
+  std::string&& release() { return std::move( unshare() ); }
+  size_t size() const
+  {
+    if ( not block_ ) {
+      return 0;
+    }
+    return length_ == WHOLE ? block_->data.size() : length_;
+  }
+  size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
 };
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "buffer.hh"
+
+#include <cstddef>
+
+// Hands out fixed-size Buffers for reads to land in.
+//
+// The blocks come from the calling thread's Buffer arena, which takes them back
+// (capacity intact) as soon as the last Buffer referring to them is destroyed,
+// so a steady stream of reads keeps landing in the same few blocks.
+class BufferPool
+{
+  size_t block_size_;
+
+public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 16384; // matches FileDescriptor's read size
+
+  explicit BufferPool( size_t block_size = DEFAULT_BLOCK_SIZE ) : block_size_( block_size ) {}
+
+  // A Buffer of size block_size(), backed by a recycled block when one is available
+  Buffer acquire() const { return Buffer::with_size( block_size_ ); }
+
+  size_t block_size() const { return block_size_; }
+};
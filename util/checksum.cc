@@ -0,0 +1,193 @@
+#include "checksum.hh"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Each kernel returns the ones'-complement sum of `data` taken as 16-bit words in *host* byte order,
+// folded to 16 bits. By the byte-order independence of the Internet checksum (RFC 1071), swapping that
+// result gives the sum over big-endian words. A trailing odd byte counts as the first half of a word.
+
+namespace {
+
+uint16_t fold( uint64_t sum )
+{
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+  }
+  return sum;
+}
+
+// Sum whatever is left after a wide kernel: 32-bit words, then a 16-bit word, then an odd byte
+uint64_t sum_tail( const char* data, size_t len, uint64_t sum )
+{
+  for ( ; len >= 4; data += 4, len -= 4 ) {
+    uint32_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    sum += word;
+  }
+  if ( len >= 2 ) {
+    uint16_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    sum += word;
+    data += 2;
+    len -= 2;
+  }
+  if ( len ) {
+    // the odd byte is the first (most significant) half of a big-endian word
+    array<char, 2> word { *data, 0 };
+    uint16_t val {};
+    memcpy( &val, word.data(), sizeof( val ) );
+    sum += val;
+  }
+  return sum;
+}
+
+// Portable: add each 64-bit word as two 32-bit halves into a 64-bit accumulator
+uint16_t sum_words64( const char* data, size_t len )
+{
+  uint64_t sum = 0;
+  for ( ; len >= 8; data += 8, len -= 8 ) {
+    uint64_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    sum += ( word & 0xffffffff ) + ( word >> 32 );
+  }
+  return fold( sum_tail( data, len, sum ) );
+}
+
+#if defined( __x86_64__ )
+
+// SSE2: widen 32-bit words into 64-bit lanes and accumulate 16 bytes per step
+__attribute__( ( target( "sse2" ) ) ) uint16_t sum_sse2( const char* data, size_t len )
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  for ( ; len >= 16; data += 16, len -= 16 ) {
+    const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) ); // NOLINT(*-reinterpret-cast)
+    acc = _mm_add_epi64( acc, _mm_unpacklo_epi32( v, zero ) );
+    acc = _mm_add_epi64( acc, _mm_unpackhi_epi32( v, zero ) );
+  }
+
+  array<uint64_t, 2> lanes {};
+  _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes.data() ), acc ); // NOLINT(*-reinterpret-cast)
+  return fold( sum_tail( data, len, fold( lanes[0] ) + fold( lanes[1] ) ) );
+}
+
+// AVX2: as SSE2, 32 bytes per step
+__attribute__( ( target( "avx2" ) ) ) uint16_t sum_avx2( const char* data, size_t len )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+  for ( ; len >= 32; data += 32, len -= 32 ) {
+    const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data ) ); // NOLINT(*-reinterpret-cast)
+    acc = _mm256_add_epi64( acc, _mm256_unpacklo_epi32( v, zero ) );
+    acc = _mm256_add_epi64( acc, _mm256_unpackhi_epi32( v, zero ) );
+  }
+
+  array<uint64_t, 4> lanes {};
+  _mm256_storeu_si256( reinterpret_cast<__m256i*>( lanes.data() ), acc ); // NOLINT(*-reinterpret-cast)
+  uint64_t sum = 0;
+  for ( const auto lane : lanes ) {
+    sum += fold( lane );
+  }
+  return fold( sum_tail( data, len, sum ) );
+}
+
+#endif
+
+using Kernel = InternetChecksum::Kernel;
+
+struct Dispatch
+{
+  Kernel kernel;
+  string_view name;
+};
+
+// The kernels this CPU can run, fastest first
+vector<Dispatch> supported_kernels()
+{
+  vector<Dispatch> kernels;
+#if defined( __x86_64__ )
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    kernels.push_back( { sum_avx2, "avx2" } );
+  }
+  if ( __builtin_cpu_supports( "sse2" ) ) {
+    kernels.push_back( { sum_sse2, "sse2" } );
+  }
+#endif
+  kernels.push_back( { sum_words64, "words64" } );
+  return kernels;
+}
+
+// Chosen on first use (not by a namespace-scope initializer), so that checksums computed while
+// other translation units' statics are being initialized find it ready
+const Dispatch& dispatch()
+{
+  static const Dispatch chosen = supported_kernels().front();
+  return chosen;
+}
+
+uint16_t to_big_endian_sum( uint16_t host_order_sum )
+{
+  if constexpr ( endian::native == endian::little ) {
+    return __builtin_bswap16( host_order_sum );
+  }
+  return host_order_sum;
+}
+
+} // namespace
+
+void InternetChecksum::add( string_view data )
+{
+  // headers are too short for the vector kernels to pay for their setup
+  add_with( data.size() < 64 ? sum_words64 : dispatch().kernel, data );
+}
+
+void InternetChecksum::add( string_view data, string_view kernel )
+{
+  for ( const auto& candidate : supported_kernels() ) {
+    if ( candidate.name == kernel ) {
+      add_with( candidate.kernel, data );
+      return;
+    }
+  }
+  throw runtime_error( "InternetChecksum: kernel " + string( kernel ) + " is not available on this CPU" );
+}
+
+void InternetChecksum::add_with( Kernel kernel, string_view data )
+{
+  if ( data.empty() ) {
+    return;
+  }
+
+  // finish the word whose first half ended the previous call
+  if ( parity_ ) {
+    sum_ += static_cast<uint8_t>( data.front() );
+    data.remove_prefix( 1 );
+    parity_ = false;
+  }
+
+  sum_ += to_big_endian_sum( kernel( data.data(), data.size() ) );
+  parity_ = data.size() % 2;
+}
+
+string_view InternetChecksum::implementation()
+{
+  return dispatch().name;
+}
+
+vector<string_view> InternetChecksum::kernels()
+{
+  vector<string_view> names;
+  for ( const auto& kernel : supported_kernels() ) {
+    names.push_back( kernel.name );
+  }
+  return names;
+}
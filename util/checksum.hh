@@ -4,18 +4,24 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 //! The internet checksum algorithm
 class InternetChecksum
 {
 private:
-  uint32_t sum_;
-  bool parity_ {};
+  uint64_t sum_;
+  bool parity_ {}; // true if the last byte added was the first half of a 16-bit word
 
 public:
   explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
+
+  //! Add bytes to the checksum, using the widest kernel (AVX2, SSE2 or 64-bit words) this CPU supports
+  void add( std::string_view data );
+
+  //! Add bytes one at a time (the reference algorithm, kept for testing and benchmarking)
+  void add_scalar( std::string_view data )
   {
     for ( const uint8_t i : data ) {
       uint16_t val = i;
@@ -29,7 +35,7 @@ public:
 
   uint16_t value() const
   {
-    uint32_t ret = sum_;
+    uint64_t ret = sum_;
 
     while ( ret > 0xffff ) {
       ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
@@ -44,4 +50,37 @@ public:
       add( x );
     }
   }
+
+  //! Update a checksum after one 16-bit word it covers changes from `old_word` to `new_word`,
+  //! without revisiting the rest of the data (RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m'))
+  static uint16_t adjust16( const uint16_t cksum, const uint16_t old_word, const uint16_t new_word )
+  {
+    InternetChecksum check { static_cast<uint16_t>( ~cksum ) };
+    check.sum_ += static_cast<uint16_t>( ~old_word );
+    check.sum_ += new_word;
+    return check.value();
+  }
+
+  //! As above, for a 32-bit field (e.g. an address) made of two 16-bit words
+  static uint16_t adjust32( const uint16_t cksum, const uint32_t old_value, const uint32_t new_value )
+  {
+    const uint16_t high
+      = adjust16( cksum, static_cast<uint16_t>( old_value >> 16 ), static_cast<uint16_t>( new_value >> 16 ) );
+    return adjust16( high, static_cast<uint16_t>( old_value ), static_cast<uint16_t>( new_value ) );
+  }
+
+  //! Name of the kernel that add() dispatches to on this CPU
+  static std::string_view implementation();
+
+  //! Names of the kernels this CPU can run, fastest first
+  static std::vector<std::string_view> kernels();
+
+  //! Add bytes with the named kernel, whatever their length (for testing each kernel directly)
+  void add( std::string_view data, std::string_view kernel );
+
+  //! A summing kernel: the ones'-complement sum of host-order 16-bit words, folded to 16 bits
+  using Kernel = uint16_t ( * )( const char*, size_t );
+
+private:
+  void add_with( Kernel kernel, std::string_view data );
 };
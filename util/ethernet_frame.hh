@@ -11,6 +11,21 @@ struct EthernetFrame
   EthernetHeader header {};
   std::vector<Buffer> payload {};
 
+  // Attach `header` already serialized (e.g. a Buffer shared by every frame to one neighbor).
+  // serialize() emits it instead of encoding the header again for as long as `header` still
+  // equals the header it was attached for; changing `header` retires it.
+  void set_header_image( Buffer image )
+  {
+    header_image_ = std::move( image );
+    image_of_ = header;
+  }
+
+  // The attached header image, or null if there is none or `header` has changed since
+  const Buffer* header_image() const
+  {
+    return header_image_.empty() or header != image_of_ ? nullptr : &header_image_;
+  }
+
   void parse( Parser& parser )
   {
     header.parse( parser );
@@ -19,7 +34,15 @@ struct EthernetFrame
 
   void serialize( Serializer& serializer ) const
   {
-    header.serialize( serializer );
+    if ( const Buffer* image = header_image() ) {
+      serializer.buffer( *image );
+    } else {
+      header.serialize( serializer );
+    }
     serializer.buffer( payload );
   }
+
+private:
+  Buffer header_image_ {};
+  EthernetHeader image_of_ {}; // the header that header_image_ encodes
 };
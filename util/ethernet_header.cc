@@ -1,5 +1,7 @@
 #include "ethernet_header.hh"
+#include "header_codec.hh"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -41,34 +43,31 @@ string EthernetHeader::to_string() const
   return ss.str();
 }
 
+// Wire layout: destination address, source address, then frame type (e.g. IPv4, ARP, or something else)
+using EthernetLayout = HeaderLayout<EthernetHeader,
+                                    EthernetHeader::LENGTH,
+                                    Field<0, 48, &EthernetHeader::dst>,
+                                    Field<48, 48, &EthernetHeader::src>,
+                                    Field<96, 16, &EthernetHeader::type>>;
+
 void EthernetHeader::parse( Parser& parser )
 {
-  // read destination address
-  for ( auto& b : dst ) {
-    parser.integer( b );
-  }
-
-  // read source address
-  for ( auto& b : src ) {
-    parser.integer( b );
-  }
-
-  // read frame type (e.g. IPv4, ARP, or something else)
-  parser.integer( type );
+  EthernetLayout::parse( parser, *this );
 }
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
-  // write destination address
-  for ( const auto& b : dst ) {
-    serializer.integer( b );
-  }
+  EthernetLayout::serialize( *this, serializer );
+}
 
-  // write source address
-  for ( const auto& b : src ) {
-    serializer.integer( b );
-  }
+void EthernetHeader::decode( const span<const char, LENGTH> raw )
+{
+  EthernetLayout::Image image {};
+  ranges::copy( raw, image.begin() );
+  EthernetLayout::decode( image, *this );
+}
 
-  // write frame type (e.g. IPv4, ARP, or something else)
-  serializer.integer( type );
+void EthernetHeader::encode( const span<char, LENGTH> raw ) const
+{
+  ranges::copy( EthernetLayout::encode( *this ), raw.begin() );
 }
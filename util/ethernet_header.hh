@@ -4,6 +4,7 @@
 
 #include <array>
 #include <cstdint>
+#include <span>
 #include <string>
 
 // Helper type for an Ethernet address (an array of six bytes)
@@ -29,6 +30,12 @@ struct EthernetHeader
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
+  bool operator==( const EthernetHeader& other ) const = default;
+
   void parse( Parser& parser );
   void serialize( Serializer& serializer ) const;
+
+  // Decode from / encode into raw wire bytes the caller owns (e.g. a slot in a packet ring)
+  void decode( std::span<const char, LENGTH> raw );
+  void encode( std::span<char, LENGTH> raw ) const;
 };
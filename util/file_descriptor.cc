@@ -84,10 +84,22 @@ void FileDescriptor::read( string& buffer )
 {
   buffer.clear();
   buffer.resize( kReadBufferSize );
+  read_into( buffer );
+}
 
+// buffer is replaced with a block from pool, which is then read into
+void FileDescriptor::read( Buffer& buffer, const BufferPool& pool )
+{
+  buffer = pool.acquire();
+  read_into( buffer );
+}
+
+void FileDescriptor::read_into( string& buffer )
+{
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      buffer.clear(); // nothing was read
       return;
     }
     throw unix_error { "read" };
@@ -169,7 +181,8 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
     = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
   register_write();
 
-  if ( bytes_written == 0 and total_size != 0 ) {
+  // a non-blocking descriptor that would block reports zero bytes written
+  if ( bytes_written == 0 and total_size != 0 and not internal_fd_->non_blocking_ ) {
     throw runtime_error( "write returned 0 given non-empty input buffer" );
   }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer_pool.hh"
+
 #include <cstddef>
 #include <limits>
 #include <memory>
@@ -43,6 +45,9 @@ class FileDescriptor
   // private constructor used to duplicate the FileDescriptor (increase the reference count)
   explicit FileDescriptor( std::shared_ptr<FDWrapper> other_shared_ptr );
 
+  // Read into `buffer` (already sized to the most to read), then shrink it to the bytes actually read
+  void read_into( std::string& buffer );
+
 protected:
   // size of buffer to allocate for read()
   static constexpr size_t kReadBufferSize = 16384;
@@ -65,6 +70,9 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::unique_ptr<std::string>>& buffers );
 
+  // Read into a block drawn from `pool` (the block returns to the pool once `buffer` and its copies are gone)
+  void read( Buffer& buffer, const BufferPool& pool );
+
   // Attempt to write a buffer
   // returns number of bytes written
   size_t write( std::string_view buffer );
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "parser.hh"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// A compile-time description of a fixed-layout protocol header, from which
+// branch-free parse and serialize code is generated.
+//
+// Each Field names a member of the header struct and the bits it occupies on
+// the wire, counting from bit 0 = the most significant bit of the first byte
+// (the numbering used by the RFC diagrams). For example, the IPv4 flags and
+// fragment offset are Field<49, 1, &IPv4Header::df>, Field<50, 1,
+// &IPv4Header::mf> and Field<51, 13, &IPv4Header::offset>.
+//
+// A HeaderLayout checks at compile time that its fields fit in the header and
+// do not overlap. Bits not covered by any field are written as zero and ignored
+// when parsing.
+
+// The unsigned type used to read a header field that spans `bytes` bytes
+template<size_t bytes>
+using HeaderWordFor = std::conditional_t<
+  bytes == 1,
+  uint8_t,
+  std::conditional_t<bytes == 2, uint16_t, std::conditional_t<bytes <= 4, uint32_t, uint64_t>>>;
+
+template<class T>
+struct IsByteArray : std::false_type
+{};
+
+template<size_t N>
+struct IsByteArray<std::array<uint8_t, N>> : std::true_type
+{};
+
+template<size_t BitOffset, size_t BitWidth, auto Member>
+struct Field
+{
+  static constexpr size_t BIT_OFFSET = BitOffset;
+  static constexpr size_t BIT_WIDTH = BitWidth;
+
+  static constexpr size_t FIRST_BYTE = BitOffset / 8;
+  static constexpr size_t SPAN = ( BitOffset % 8 + BitWidth + 7 ) / 8;            // bytes touched
+  static constexpr bool WHOLE_BYTES = BitOffset % 8 == 0 and BitWidth % 8 == 0; // no neighbouring bits
+  static constexpr bool POWER_OF_TWO_SPAN = SPAN == 1 or SPAN == 2 or SPAN == 4 or SPAN == 8;
+
+  using Word = HeaderWordFor<SPAN>;
+  static constexpr size_t SHIFT = sizeof( Word ) * 8 - BitOffset % 8 - BitWidth; // from the word's low bit
+  static constexpr Word MASK
+    = static_cast<Word>( BitWidth >= 64 ? ~uint64_t {} : ( uint64_t { 1 } << BitWidth ) - 1 );
+
+  // The SPAN bytes that hold the field, as a big-endian word (left-aligned if SPAN is not a power of two)
+  static Word load( const char* raw )
+  {
+    if constexpr ( POWER_OF_TWO_SPAN ) {
+      return load_big_endian<Word>( raw + FIRST_BYTE );
+    } else {
+      std::array<char, sizeof( Word )> bytes {};
+      std::memcpy( bytes.data(), raw + FIRST_BYTE, SPAN );
+      return load_big_endian<Word>( bytes.data() );
+    }
+  }
+
+  static void store( char* raw, Word word )
+  {
+    if constexpr ( POWER_OF_TWO_SPAN ) {
+      store_big_endian( raw + FIRST_BYTE, word );
+    } else {
+      std::array<char, sizeof( Word )> bytes {};
+      store_big_endian( bytes.data(), word );
+      std::memcpy( raw + FIRST_BYTE, bytes.data(), SPAN );
+    }
+  }
+
+  template<class Header>
+  static void decode( const char* raw, Header& header )
+  {
+    auto& member = header.*Member;
+    using T = std::remove_cvref_t<decltype( member )>;
+
+    if constexpr ( IsByteArray<T>::value ) {
+      static_assert( WHOLE_BYTES and BitWidth == 8 * std::tuple_size_v<T>, "byte array must fill its field" );
+      std::memcpy( member.data(), raw + FIRST_BYTE, member.size() );
+    } else {
+      static_assert( std::same_as<T, bool> or std::unsigned_integral<T>, "unsupported field type" );
+      static_assert( BitWidth <= 8 * sizeof( T ), "field is wider than its member" );
+      member = static_cast<T>( ( load( raw ) >> SHIFT ) & MASK );
+    }
+  }
+
+  template<class Header>
+  static void encode( const Header& header, char* raw )
+  {
+    const auto& member = header.*Member;
+    using T = std::remove_cvref_t<decltype( member )>;
+
+    if constexpr ( IsByteArray<T>::value ) {
+      std::memcpy( raw + FIRST_BYTE, member.data(), member.size() );
+    } else {
+      const Word bits = static_cast<Word>( ( static_cast<Word>( member ) & MASK ) << SHIFT );
+      if constexpr ( WHOLE_BYTES and POWER_OF_TWO_SPAN ) {
+        store( raw, bits ); // the field owns every bit of its word
+      } else {
+        store( raw, load( raw ) | bits ); // merge with the fields that share its bytes
+      }
+    }
+  }
+};
+
+template<class Header, size_t Length, class... Fields>
+struct HeaderLayout
+{
+  static constexpr size_t LENGTH = Length;
+
+  using Image = std::array<char, Length>;
+
+  // true if every field fits in the header and no two fields share a bit
+  static constexpr bool well_formed()
+  {
+    std::array<bool, Length * 8> used {};
+    bool ok = true;
+    auto claim = [&]( size_t offset, size_t width ) {
+      if ( width == 0 or offset + width > Length * 8 ) {
+        ok = false;
+        return;
+      }
+      for ( size_t bit = offset; bit < offset + width; ++bit ) {
+        ok = ok and not used.at( bit );
+        used.at( bit ) = true;
+      }
+    };
+    ( claim( Fields::BIT_OFFSET, Fields::BIT_WIDTH ), ... );
+    return ok;
+  }
+
+  static_assert( well_formed(), "header fields overlap or extend past the end of the header" );
+
+  static void decode( const Image& raw, Header& header ) { ( Fields::decode( raw.data(), header ), ... ); }
+
+  static Image encode( const Header& header )
+  {
+    Image raw {};
+    ( Fields::encode( header, raw.data() ), ... );
+    return raw;
+  }
+
+  // Read Length bytes from the parser in one shot and decode them
+  static void parse( Parser& parser, Header& header )
+  {
+    Image raw {};
+    parser.string( raw );
+    decode( raw, header );
+  }
+
+  static void serialize( const Header& header, Serializer& serializer )
+  {
+    const Image raw = encode( header );
+    serializer.string( { raw.data(), raw.size() } );
+  }
+};
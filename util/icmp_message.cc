@@ -0,0 +1,61 @@
+#include "icmp_message.hh"
+#include "checksum.hh"
+#include "header_codec.hh"
+
+#include <sstream>
+
+using namespace std;
+
+// Wire layout of the fixed part of every ICMP message
+using ICMPLayout = HeaderLayout<ICMPMessage,
+                                ICMPMessage::HEADER_LENGTH,
+                                Field<0, 8, &ICMPMessage::type>,
+                                Field<8, 8, &ICMPMessage::code>,
+                                Field<16, 16, &ICMPMessage::cksum>,
+                                Field<32, 32, &ICMPMessage::rest>>;
+
+bool ICMPMessage::is_error( const uint8_t type )
+{
+  // Destination Unreachable, Source Quench, Redirect, Time Exceeded and Parameter Problem
+  return type == 3 or type == 4 or type == 5 or type == 11 or type == 12;
+}
+
+void ICMPMessage::compute_checksum()
+{
+  cksum = 0;
+  const ICMPLayout::Image header = ICMPLayout::encode( *this );
+  InternetChecksum check;
+  check.add( { header.data(), header.size() } );
+  check.add( payload );
+  cksum = check.value();
+}
+
+string ICMPMessage::to_string() const
+{
+  stringstream ss {};
+  ss << "ICMP type=" << static_cast<int>( type ) << ", code=" << static_cast<int>( code );
+  if ( type == TYPE_DESTINATION_UNREACHABLE and code == CODE_FRAGMENTATION_NEEDED ) {
+    ss << ", next-hop MTU=" << next_hop_mtu();
+  }
+  return ss.str();
+}
+
+void ICMPMessage::parse( Parser& parser )
+{
+  ICMPLayout::parse( parser, *this );
+  parser.all_remaining( payload );
+
+  // Verify checksum
+  const uint16_t given_cksum = cksum;
+  compute_checksum();
+  if ( cksum != given_cksum ) {
+    parser.set_error();
+  }
+}
+
+// Serialize the ICMP message (does not recompute the checksum)
+void ICMPMessage::serialize( Serializer& serializer ) const
+{
+  ICMPLayout::serialize( *this, serializer );
+  serializer.buffer( payload );
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "buffer.hh"
+#include "parser.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// [ICMP](\ref rfc::rfc792) message (the errors a router sends, and echo)
+struct ICMPMessage
+{
+  static constexpr size_t HEADER_LENGTH = 8; // type, code, checksum and the "rest of header" word
+
+  static constexpr uint8_t TYPE_ECHO_REPLY = 0;
+  static constexpr uint8_t TYPE_DESTINATION_UNREACHABLE = 3;
+  static constexpr uint8_t TYPE_ECHO_REQUEST = 8;
+  static constexpr uint8_t TYPE_TIME_EXCEEDED = 11;
+
+  static constexpr uint8_t CODE_NET_UNREACHABLE = 0;       // with TYPE_DESTINATION_UNREACHABLE
+  static constexpr uint8_t CODE_HOST_UNREACHABLE = 1;      // with TYPE_DESTINATION_UNREACHABLE
+  static constexpr uint8_t CODE_FRAGMENTATION_NEEDED = 4;  // with TYPE_DESTINATION_UNREACHABLE (RFC 1191)
+  static constexpr uint8_t CODE_TTL_EXCEEDED = 0;          // with TYPE_TIME_EXCEEDED
+  static constexpr uint8_t CODE_REASSEMBLY_TIMEOUT = 1;    // with TYPE_TIME_EXCEEDED
+
+  // Bytes of the offending datagram's payload quoted after its header in an error message
+  static constexpr size_t QUOTED_PAYLOAD = 8;
+
+  uint8_t type {};
+  uint8_t code {};
+  uint16_t cksum {};
+  uint32_t rest {}; // unused (zero), or e.g. the next-hop MTU in the low 16 bits for Fragmentation Needed
+  std::vector<Buffer> payload {}; // for errors: the offending datagram's header and first bytes of payload
+
+  // Is this one of the error messages (which must never themselves cause an error message)?
+  static bool is_error( uint8_t type );
+
+  // Next-hop MTU of a Fragmentation Needed message
+  uint16_t next_hop_mtu() const { return static_cast<uint16_t>( rest ); }
+
+  // Set checksum to correct value (over the header and payload)
+  void compute_checksum();
+
+  // Return a string containing the message header in human-readable format
+  std::string to_string() const;
+
+  void parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+};
@@ -1,5 +1,6 @@
 #include "ipv4_header.hh"
 #include "checksum.hh"
+#include "header_codec.hh"
 
 #include <arpa/inet.h>
 #include <array>
@@ -8,28 +9,27 @@
 
 using namespace std;
 
+// Wire layout of the fixed 20-byte header (options are not supported)
+using IPv4Layout = HeaderLayout<IPv4Header,
+                                IPv4Header::LENGTH,
+                                Field<0, 4, &IPv4Header::ver>,
+                                Field<4, 4, &IPv4Header::hlen>,
+                                Field<8, 8, &IPv4Header::tos>,
+                                Field<16, 16, &IPv4Header::len>,
+                                Field<32, 16, &IPv4Header::id>,
+                                Field<49, 1, &IPv4Header::df>,
+                                Field<50, 1, &IPv4Header::mf>,
+                                Field<51, 13, &IPv4Header::offset>,
+                                Field<64, 8, &IPv4Header::ttl>,
+                                Field<72, 8, &IPv4Header::proto>,
+                                Field<80, 16, &IPv4Header::cksum>,
+                                Field<96, 32, &IPv4Header::src>,
+                                Field<128, 32, &IPv4Header::dst>>;
+
 // Parse from string.
 void IPv4Header::parse( Parser& parser )
 {
-  uint8_t first_byte {};
-  parser.integer( first_byte );
-  ver = first_byte >> 4;    // version
-  hlen = first_byte & 0x0f; // header length
-  parser.integer( tos );    // type of service
-  parser.integer( len );
-  parser.integer( id );
-
-  uint16_t fo_val {};
-  parser.integer( fo_val );
-  df = static_cast<bool>( fo_val & 0x4000 ); // don't fragment
-  mf = static_cast<bool>( fo_val & 0x2000 ); // more fragments
-  offset = fo_val & 0x1fff;                  // offset
-
-  parser.integer( ttl );
-  parser.integer( proto );
-  parser.integer( cksum );
-  parser.integer( src );
-  parser.integer( dst );
+  IPv4Layout::parse( parser, *this );
 
   if ( ver != 4 ) {
     parser.set_error();
@@ -57,22 +57,7 @@ void IPv4Header::serialize( Serializer& serializer ) const
     throw runtime_error( "wrong IP version" );
   }
 
-  const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
-  serializer.integer( first_byte ); // version and header length
-  serializer.integer( tos );
-  serializer.integer( len );
-  serializer.integer( id );
-
-  const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
-  serializer.integer( fo_val );
-
-  serializer.integer( ttl );
-  serializer.integer( proto );
-
-  serializer.integer( cksum );
-
-  serializer.integer( src );
-  serializer.integer( dst );
+  IPv4Layout::serialize( *this, serializer );
 }
 
 uint16_t IPv4Header::payload_length() const
@@ -102,14 +87,38 @@ uint32_t IPv4Header::pseudo_checksum() const
 
 void IPv4Header::compute_checksum()
 {
-  cksum = 0;
-  Serializer s;
-  serialize( s );
-
-  // calculate checksum -- taken over header only
-  InternetChecksum check;
-  check.add( s.output() );
-  cksum = check.value();
+  // calculate checksum -- taken over header only, summing its 16-bit words straight from the fields
+  // (no serialization; the checksum word itself counts as zero)
+  uint32_t sum = ( ( ver & 0xfU ) << 12 ) | ( ( hlen & 0xfU ) << 8 ) | tos;
+  sum += len;
+  sum += id;
+  sum += ( static_cast<uint32_t>( df ) << 14 ) | ( static_cast<uint32_t>( mf ) << 13 ) | ( offset & 0x1fffU );
+  sum += ( static_cast<uint32_t>( ttl ) << 8 ) | proto;
+  sum += ( src >> 16 ) + static_cast<uint16_t>( src );
+  sum += ( dst >> 16 ) + static_cast<uint16_t>( dst );
+
+  cksum = InternetChecksum { sum }.value();
+}
+
+// TTL and protocol share the header's fifth 16-bit word
+void IPv4Header::decrement_ttl()
+{
+  const uint16_t old_word = ( ttl << 8 ) | proto;
+  --ttl;
+  const uint16_t new_word = ( ttl << 8 ) | proto;
+  cksum = InternetChecksum::adjust16( cksum, old_word, new_word );
+}
+
+void IPv4Header::set_src( const uint32_t new_src )
+{
+  cksum = InternetChecksum::adjust32( cksum, src, new_src );
+  src = new_src;
+}
+
+void IPv4Header::set_dst( const uint32_t new_dst )
+{
+  cksum = InternetChecksum::adjust32( cksum, dst, new_dst );
+  dst = new_dst;
 }
 
 std::string IPv4Header::to_string() const
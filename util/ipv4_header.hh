@@ -11,6 +11,7 @@ struct IPv4Header
 {
   static constexpr size_t LENGTH = 20;        // IPv4 header length, not including options
   static constexpr uint8_t DEFAULT_TTL = 128; // A reasonable default TTL value
+  static constexpr uint8_t PROTO_ICMP = 1;    // Protocol number for ICMP
   static constexpr uint8_t PROTO_TCP = 6;     // Protocol number for TCP
 
   static constexpr uint64_t serialized_length() { return LENGTH; }
@@ -57,6 +58,13 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Decrement the TTL, patching the checksum incrementally (RFC 1624) rather than recomputing it
+  void decrement_ttl();
+
+  // Rewrite the src or dst address, patching the checksum incrementally
+  void set_src( uint32_t new_src );
+  void set_dst( uint32_t new_dst );
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
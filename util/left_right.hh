@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+// Two copies of a T, arranged so that readers never wait for (or block) the writer
+// (the "Left-Right" technique, an RCU-style scheme without garbage collection).
+//
+// Readers always use the copy that is currently published. The writer applies each
+// modification to the other copy, publishes it, waits until no reader can still be
+// using the old copy, and then applies the same modification to the old copy. A
+// modification must therefore be deterministic, since it runs once on each copy.
+//
+// Any number of threads may call read(); modify() must only be called by one thread at a time.
+template<class T>
+class LeftRight
+{
+  std::array<T, 2> copies_ {};
+  std::atomic<unsigned> published_ { 0 }; // index of the copy readers use
+  std::atomic<unsigned> version_ { 0 };   // which reader counter new readers announce themselves in
+  mutable std::array<std::atomic<uint64_t>, 2> readers_ {}; // readers in progress, per version
+
+  void wait_for_readers( const unsigned version ) const
+  {
+    while ( readers_[version].load() != 0 ) {
+      std::this_thread::yield();
+    }
+  }
+
+public:
+  LeftRight() = default;
+  explicit LeftRight( const T& initial ) : copies_ { initial, initial } {}
+
+  // Call `reader` with the published copy and return its result
+  template<class Reader>
+  decltype( auto ) read( Reader&& reader ) const
+  {
+    const unsigned version = version_.load();
+    readers_[version].fetch_add( 1 );
+
+    struct Departure
+    {
+      std::atomic<uint64_t>& counter;
+      ~Departure() { counter.fetch_sub( 1 ); }
+    } departure { readers_[version] };
+
+    return std::forward<Reader>( reader )( std::as_const( copies_[published_.load()] ) );
+  }
+
+  // Apply `writer` to both copies in turn, publishing the first before touching the second
+  template<class Writer>
+  void modify( Writer&& writer )
+  {
+    const unsigned hidden = 1 - published_.load();
+    writer( copies_[hidden] );
+    published_.store( hidden );
+
+    // Readers that started before the flip may still hold the old copy. They announced
+    // themselves in one of the two version counters; move new readers to the other
+    // counter and wait for both to drain.
+    const unsigned old_version = version_.load();
+    wait_for_readers( 1 - old_version );
+    version_.store( 1 - old_version );
+    wait_for_readers( old_version );
+
+    writer( copies_[1 - hidden] );
+  }
+
+  // The published copy, for callers that know no modification is in progress
+  const T& get() const { return copies_[published_.load()]; }
+};
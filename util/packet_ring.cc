@@ -0,0 +1,206 @@
+#include "packet_ring.hh"
+
+#include "exception.hh"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace {
+
+// Where the frame starts within a transmit slot (the kernel's default, without PACKET_TX_HAS_OFF)
+constexpr size_t TX_DATA_OFFSET = TPACKET3_HDRLEN - sizeof( sockaddr_ll );
+
+template<class T>
+string_view raw_bytes( const T& value )
+{
+  return { reinterpret_cast<const char*>( &value ), sizeof( value ) }; // NOLINT(*-reinterpret-cast)
+}
+
+// Status words are shared with the kernel: acquire when taking a slot over, release when handing it back
+uint32_t load_status( uint32_t& status )
+{
+  return atomic_ref { status }.load( memory_order_acquire );
+}
+
+void store_status( uint32_t& status, uint32_t value )
+{
+  atomic_ref { status }.store( value, memory_order_release );
+}
+
+} // namespace
+
+void PacketRing::Unmap::operator()( char* addr ) const
+{
+  ::munmap( addr, length );
+}
+
+PacketRing::PacketRing( const string& interface, const Config& config )
+  : PacketSocket( SOCK_RAW, htons( ETH_P_ALL ) ), config_( config ), map_( nullptr, Unmap {} )
+{
+  const unsigned int ifindex = if_nametoindex( interface.c_str() );
+  if ( ifindex == 0 ) {
+    throw unix_error { "if_nametoindex(" + interface + ")" };
+  }
+
+  setsockopt( SOL_PACKET, PACKET_VERSION, raw_bytes( int { TPACKET_V3 } ) );
+
+  tpacket_req3 rx {};
+  rx.tp_block_size = config_.block_size;
+  rx.tp_block_nr = config_.rx_blocks;
+  rx.tp_frame_size = config_.tx_frame_size; // receive frames are variable-length; this only sets the count
+  rx.tp_frame_nr = config_.block_size / config_.tx_frame_size * config_.rx_blocks;
+  rx.tp_retire_blk_tov = config_.rx_timeout_ms;
+  setsockopt( SOL_PACKET, PACKET_RX_RING, raw_bytes( rx ) );
+
+  tpacket_req3 tx {};
+  tx.tp_block_size = config_.block_size;
+  tx.tp_block_nr = config_.tx_blocks;
+  tx.tp_frame_size = config_.tx_frame_size;
+  tx.tp_frame_nr = config_.block_size / config_.tx_frame_size * config_.tx_blocks;
+  setsockopt( SOL_PACKET, PACKET_TX_RING, raw_bytes( tx ) );
+  tx_slots_ = tx.tp_frame_nr;
+
+  const size_t length = size_t { config_.block_size } * ( config_.rx_blocks + config_.tx_blocks );
+  void* const addr = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_num(), 0 );
+  if ( addr == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    throw unix_error { "mmap" };
+  }
+  map_ = { static_cast<char*>( addr ), Unmap { length } };
+
+  sockaddr_ll link {};
+  link.sll_family = AF_PACKET;
+  link.sll_protocol = htons( ETH_P_ALL );
+  link.sll_ifindex = static_cast<int>( ifindex );
+  bind( { reinterpret_cast<const sockaddr*>( &link ), sizeof( link ) } ); // NOLINT(*-reinterpret-cast)
+}
+
+char* PacketRing::rx_block_at( const uint32_t index ) const
+{
+  return map_.get() + size_t { index } * config_.block_size;
+}
+
+char* PacketRing::tx_slot_at( const uint32_t index ) const
+{
+  const uint32_t per_block = config_.block_size / config_.tx_frame_size;
+  return rx_block_at( config_.rx_blocks + index / per_block ) + size_t { index % per_block } * config_.tx_frame_size;
+}
+
+size_t PacketRing::max_frame_size() const
+{
+  return config_.tx_frame_size - TX_DATA_OFFSET;
+}
+
+bool PacketRing::send_frame( const EthernetFrame& frame )
+{
+  size_t length = EthernetHeader::LENGTH;
+  for ( const auto& buf : frame.payload ) {
+    length += buf.size();
+  }
+  if ( length > max_frame_size() ) {
+    throw runtime_error( "PacketRing::send_frame: frame of " + to_string( length ) + " bytes does not fit a slot" );
+  }
+
+  char* const slot = tx_slot_at( tx_slot_ );
+  auto* const hdr = reinterpret_cast<tpacket3_hdr*>( slot ); // NOLINT(*-reinterpret-cast)
+  if ( load_status( hdr->tp_status ) & ( TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING ) ) {
+    ++tx_ring_full_;
+    return false;
+  }
+
+  char* out = slot + TX_DATA_OFFSET;
+  const Buffer* image = frame.header_image();
+  if ( image and image->size() == EthernetHeader::LENGTH ) {
+    memcpy( out, string_view { *image }.data(), EthernetHeader::LENGTH );
+  } else {
+    frame.header.encode( span<char, EthernetHeader::LENGTH> { out, EthernetHeader::LENGTH } );
+  }
+  out += EthernetHeader::LENGTH;
+  for ( const auto& buf : frame.payload ) {
+    const string_view bytes = buf;
+    memcpy( out, bytes.data(), bytes.size() );
+    out += bytes.size();
+  }
+
+  hdr->tp_len = static_cast<uint32_t>( length );
+  hdr->tp_next_offset = 0;
+  store_status( hdr->tp_status, TP_STATUS_SEND_REQUEST );
+
+  tx_slot_ = ( tx_slot_ + 1 ) % tx_slots_;
+  ++tx_pending_;
+  return true;
+}
+
+void PacketRing::flush()
+{
+  if ( tx_pending_ == 0 ) {
+    return;
+  }
+  if ( ::send( fd_num(), nullptr, 0, MSG_DONTWAIT ) < 0 ) {
+    if ( errno == EAGAIN or errno == ENOBUFS ) {
+      return; // the queued slots stay marked for sending and go out on the next flush
+    }
+    throw unix_error { "send (packet ring)" };
+  }
+  register_write();
+  tx_pending_ = 0;
+}
+
+void PacketRing::release_rx_block()
+{
+  auto* const desc = reinterpret_cast<tpacket_block_desc*>( rx_block_at( rx_block_ ) ); // NOLINT(*-reinterpret-cast)
+  store_status( desc->hdr.bh1.block_status, TP_STATUS_KERNEL );
+  rx_block_ = ( rx_block_ + 1 ) % config_.rx_blocks;
+  rx_next_ = nullptr;
+}
+
+bool PacketRing::recv_frame( EthernetFrame& frame )
+{
+  while ( true ) {
+    if ( not rx_next_ ) {
+      char* const block = rx_block_at( rx_block_ );
+      auto* const desc = reinterpret_cast<tpacket_block_desc*>( block ); // NOLINT(*-reinterpret-cast)
+      if ( not( load_status( desc->hdr.bh1.block_status ) & TP_STATUS_USER ) ) {
+        return false;
+      }
+      rx_remaining_ = desc->hdr.bh1.num_pkts;
+      rx_next_ = block + desc->hdr.bh1.offset_to_first_pkt;
+      if ( rx_remaining_ == 0 ) {
+        release_rx_block();
+        continue;
+      }
+    }
+
+    const auto* const hdr = reinterpret_cast<const tpacket3_hdr*>( rx_next_ ); // NOLINT(*-reinterpret-cast)
+    const string_view bytes { rx_next_ + hdr->tp_mac, hdr->tp_snaplen };
+    rx_next_ += hdr->tp_next_offset;
+    const bool have_frame = bytes.size() >= EthernetHeader::LENGTH;
+
+    if ( have_frame ) {
+      frame.header.decode( span<const char, EthernetHeader::LENGTH> { bytes.data(), EthernetHeader::LENGTH } );
+      frame.payload.clear();
+      if ( bytes.size() > EthernetHeader::LENGTH ) {
+        Buffer payload = Buffer::with_size( bytes.size() - EthernetHeader::LENGTH );
+        memcpy( static_cast<string&>( payload ).data(), bytes.data() + EthernetHeader::LENGTH, payload.size() );
+        frame.payload.push_back( move( payload ) );
+      }
+      register_read();
+    }
+
+    if ( --rx_remaining_ == 0 ) {
+      release_rx_block(); // every frame in it has been copied out
+    }
+    if ( have_frame ) {
+      return true;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "socket.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A raw packet socket bound to one network device, with PACKET_MMAP (TPACKET_V3) receive
+// and transmit rings shared with the kernel.
+//
+// send_frame() serializes a frame straight into the next free transmit slot (header image
+// or encoded header, then each payload Buffer), and flush() asks the kernel to send every
+// slot queued since the last flush with one system call. recv_frame() decodes frames in
+// place from the receive blocks the kernel has filled, copying each payload once into a
+// recycled Buffer, and hands a block back as soon as its last frame has been read.
+//
+// Opening one needs CAP_NET_RAW. A PacketRing is used by one thread at a time.
+class PacketRing : public PacketSocket
+{
+public:
+  struct Config
+  {
+    uint32_t block_size { 1 << 20 }; // bytes per block (a multiple of the page size)
+    uint32_t rx_blocks { 16 };
+    uint32_t tx_blocks { 4 };
+    uint32_t tx_frame_size { 2048 }; // bytes per transmit slot, including the slot header
+    uint32_t rx_timeout_ms { 10 };   // the kernel retires a partly filled receive block after this long
+  };
+
+private:
+  struct Unmap
+  {
+    size_t length {};
+    void operator()( char* addr ) const;
+  };
+
+  Config config_;
+  std::unique_ptr<char, Unmap> map_; // receive blocks, then transmit blocks
+
+  uint32_t rx_block_ {};         // receive block being read
+  uint32_t rx_remaining_ {};     // frames left in it (0: not yet handed to us)
+  const char* rx_next_ {};       // next frame header within it
+  uint32_t tx_slot_ {};          // next transmit slot to fill
+  uint32_t tx_slots_ {};         // number of transmit slots
+  size_t tx_pending_ {};         // slots queued since the last flush()
+  uint64_t tx_ring_full_ {};     // send_frame() calls that found no free slot
+
+  char* rx_block_at( uint32_t index ) const;
+  char* tx_slot_at( uint32_t index ) const;
+  void release_rx_block();
+
+public:
+  // Open a ring on the device named `interface` (e.g. "eth0")
+  explicit PacketRing( const std::string& interface, const Config& config );
+  explicit PacketRing( const std::string& interface ) : PacketRing( interface, Config {} ) {}
+
+  // The rings belong to one socket: a PacketRing can be moved but not copied
+  PacketRing( const PacketRing& other ) = delete;
+  PacketRing& operator=( const PacketRing& other ) = delete;
+  PacketRing( PacketRing&& other ) = default;
+  PacketRing& operator=( PacketRing&& other ) = default;
+  ~PacketRing() = default;
+
+  // Largest frame (header plus payload) that fits in a transmit slot
+  size_t max_frame_size() const;
+
+  // Serialize `frame` into the next transmit slot; returns false if the ring is full (flush and retry).
+  // Throws if the frame is larger than max_frame_size().
+  bool send_frame( const EthernetFrame& frame );
+
+  // Have the kernel transmit the queued slots (does not wait for them to go out)
+  void flush();
+
+  // The next received frame, if the kernel has delivered any (does not block)
+  bool recv_frame( EthernetFrame& frame );
+
+  size_t tx_pending() const { return tx_pending_; }
+  uint64_t tx_ring_full() const { return tx_ring_full_; }
+};
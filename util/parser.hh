@@ -3,6 +3,8 @@
 #include "buffer.hh"
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
@@ -12,10 +14,44 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 class Serializer;
 
+// Convert between host and big-endian (network) byte order
+template<std::unsigned_integral T>
+constexpr T to_big_endian( T val )
+{
+  if constexpr ( std::endian::native == std::endian::big or sizeof( T ) == 1 ) {
+    return val;
+  } else if constexpr ( sizeof( T ) == 2 ) {
+    return __builtin_bswap16( val );
+  } else if constexpr ( sizeof( T ) == 4 ) {
+    return __builtin_bswap32( val );
+  } else {
+    static_assert( sizeof( T ) == 8 );
+    return __builtin_bswap64( val );
+  }
+}
+
+// Load a big-endian integer from (possibly unaligned) bytes with one memcpy plus a byteswap
+template<std::unsigned_integral T>
+T load_big_endian( const char* bytes )
+{
+  T val;
+  std::memcpy( &val, bytes, sizeof( T ) );
+  return to_big_endian( val );
+}
+
+// Store an integer as big-endian into (possibly unaligned) bytes
+template<std::unsigned_integral T>
+void store_big_endian( char* bytes, T val )
+{
+  val = to_big_endian( val );
+  std::memcpy( bytes, &val, sizeof( T ) );
+}
+
 class Parser
 {
   class BufferList
@@ -59,21 +95,22 @@ class Parser
       }
     }
 
+    // Hand out everything that remains, as slices that share the underlying storage (no copy)
     void dump_all( std::vector<Buffer>& out )
     {
       out.clear();
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
+      out.reserve( buffer_.size() );
+      out.push_back( buffer_.front().substr( skip_ ) );
       buffer_.pop_front();
       for ( auto&& x : buffer_ ) {
-        out.emplace_back( std::move( x ) );
+        out.push_back( std::move( x ) );
       }
+      buffer_.clear();
+      size_ = 0;
+      skip_ = 0;
     }
 
     void dump_all( Buffer& out )
@@ -81,18 +118,22 @@ class Parser
       std::vector<Buffer> concat;
       dump_all( concat );
       if ( concat.size() == 1 ) {
-        out = concat.front();
+        out = std::move( concat.front() );
         return;
       }
 
-      out.release().clear();
+      std::string joined;
       for ( const auto& s : concat ) {
-        out.release().append( s );
+        joined.append( s );
       }
+      out = Buffer { std::move( joined ) };
     }
 
     void append( Buffer str )
     {
+      if ( str.empty() ) {
+        return; // keeps peek() non-empty whenever size() is
+      }
       size_ += str.size();
       buffer_.push_back( std::move( str ) );
     }
@@ -125,17 +166,20 @@ public:
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
-      input_.remove_prefix( 1 );
+    // fast path: the whole integer is contiguous in the front buffer
+    const std::string_view front = input_.peek();
+    if ( front.size() >= sizeof( T ) ) {
+      out = load_big_endian<T>( front.data() );
+      input_.remove_prefix( sizeof( T ) );
       return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
-      }
+    }
+
+    // slow path: the integer straddles two buffers
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
+      input_.remove_prefix( 1 );
     }
   }
 
@@ -170,14 +214,13 @@ public:
   template<std::unsigned_integral T>
   void integer( const T& val )
   {
-    constexpr uint64_t len = sizeof( T );
-
-    for ( uint64_t i = 0; i < len; ++i ) {
-      const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
-      buffer_.push_back( byte_val );
-    }
+    std::array<char, sizeof( T )> bytes {};
+    store_big_endian( bytes.data(), val );
+    buffer_.append( bytes.data(), bytes.size() );
   }
 
+  void string( std::string_view str ) { buffer_.append( str ); }
+
   void buffer( const Buffer& buf )
   {
     flush();
@@ -191,16 +234,32 @@ public:
     }
   }
 
+  // Take ownership of already-serialized data (no copy, no reference-count traffic)
+  void buffer( Buffer&& buf )
+  {
+    flush();
+    output_.push_back( std::move( buf ) );
+  }
+
+  void buffer( std::vector<Buffer>&& bufs )
+  {
+    flush();
+    for ( auto& b : bufs ) {
+      output_.push_back( std::move( b ) );
+    }
+  }
+
   void flush()
   {
     output_.emplace_back( std::move( buffer_ ) );
     buffer_.clear();
   }
 
+  // The serialized data (the Serializer is left empty)
   std::vector<Buffer> output()
   {
     flush();
-    return output_;
+    return std::exchange( output_, {} );
   }
 };
 
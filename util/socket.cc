@@ -2,9 +2,13 @@
 
 #include "exception.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
 #include <linux/if_packet.h>
 #include <net/if.h>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -138,6 +142,65 @@ void DatagramSocket::recv( Address& source_address, string& payload )
   payload.resize( recv_len );
 }
 
+size_t DatagramSocket::recv_batch( vector<ReceivedDatagram>& datagrams )
+{
+  if ( datagrams.empty() ) {
+    return 0;
+  }
+
+  // room for one UDP_GRO control message per datagram
+  struct alignas( cmsghdr ) Control
+  {
+    array<char, CMSG_SPACE( sizeof( int ) )> bytes;
+  };
+
+  vector<mmsghdr> headers( datagrams.size() );
+  vector<iovec> iovecs( datagrams.size() );
+  vector<Control> controls( datagrams.size() );
+
+  for ( size_t i = 0; i < datagrams.size(); ++i ) {
+    auto& dgram = datagrams[i];
+    // only the first call for a payload pays to zero-fill it; later ones read into it as it is
+    if ( dgram.payload.size() < max( dgram.payload.capacity(), kReadBufferSize ) ) {
+      dgram.payload.resize( max( dgram.payload.capacity(), kReadBufferSize ) );
+    }
+    iovecs[i] = { dgram.payload.data(), dgram.payload.size() };
+
+    msghdr& header = headers[i].msg_hdr;
+    header.msg_name = static_cast<sockaddr*>( dgram.source );
+    header.msg_namelen = sizeof( dgram.source.storage );
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+    header.msg_control = controls[i].bytes.data();
+    header.msg_controllen = controls[i].bytes.size();
+  }
+
+  const int count = CheckSystemCall(
+    "recvmmsg",
+    ::recvmmsg( fd_num(), headers.data(), static_cast<unsigned int>( headers.size() ), MSG_WAITFORONE, nullptr ) );
+
+  for ( size_t i = 0; i < static_cast<size_t>( count ); ++i ) {
+    auto& dgram = datagrams[i];
+    msghdr& header = headers[i].msg_hdr;
+    dgram.truncated = header.msg_flags & MSG_TRUNC; // NOLINT(*-bitwise)
+    dgram.source_size = header.msg_namelen;
+    dgram.length = headers[i].msg_len;
+    dgram.gro_segment_size = 0;
+    for ( cmsghdr* cmsg = CMSG_FIRSTHDR( &header ); cmsg != nullptr; cmsg = CMSG_NXTHDR( &header, cmsg ) ) {
+      if ( cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO ) {
+        int segment_size {};
+        memcpy( &segment_size, CMSG_DATA( cmsg ), sizeof( segment_size ) );
+        dgram.gro_segment_size = segment_size;
+      }
+    }
+  }
+
+  if ( count > 0 ) {
+    register_read();
+  }
+  return count;
+}
+
 void DatagramSocket::sendto( const Address& destination, const string_view payload )
 {
   CheckSystemCall( "sendto",
@@ -151,6 +214,53 @@ void DatagramSocket::send( const string_view payload )
   register_write();
 }
 
+size_t DatagramSocket::send_many( const Address* destination, const vector<string_view>& payloads )
+{
+  if ( payloads.empty() ) {
+    return 0;
+  }
+
+  vector<mmsghdr> headers( payloads.size() );
+  vector<iovec> iovecs( payloads.size() );
+
+  for ( size_t i = 0; i < payloads.size(); ++i ) {
+    iovecs[i] = { const_cast<char*>( payloads[i].data() ), payloads[i].size() }; // NOLINT(*-const-cast)
+
+    msghdr& header = headers[i].msg_hdr;
+    if ( destination ) {
+      header.msg_name = const_cast<sockaddr*>( static_cast<const sockaddr*>( *destination ) ); // NOLINT(*-const-cast)
+      header.msg_namelen = destination->size();
+    }
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+  }
+
+  const int count = CheckSystemCall(
+    "sendmmsg", ::sendmmsg( fd_num(), headers.data(), static_cast<unsigned int>( headers.size() ), 0 ) );
+  register_write();
+  return count;
+}
+
+size_t DatagramSocket::sendto_batch( const Address& destination, const vector<string_view>& payloads )
+{
+  return send_many( &destination, payloads );
+}
+
+size_t DatagramSocket::send_batch( const vector<string_view>& payloads )
+{
+  return send_many( nullptr, payloads );
+}
+
+void UDPSocket::set_gso_segment_size( const uint16_t segment_size )
+{
+  setsockopt( SOL_UDP, UDP_SEGMENT, int { segment_size } );
+}
+
+void UDPSocket::set_gro( const bool enabled )
+{
+  setsockopt( SOL_UDP, UDP_GRO, int { enabled } );
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen( const int backlog )
@@ -5,7 +5,9 @@
 
 #include <cstdint>
 #include <functional>
+#include <string>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -62,15 +64,46 @@ class DatagramSocket : public Socket
 {
   using Socket::Socket;
 
+  //! Send several datagrams with one [sendmmsg(2)](\ref man2::sendmmsg) (to `destination`, if given)
+  size_t send_many( const Address* destination, const std::vector<std::string_view>& payloads );
+
 public:
+  //! A datagram filled in by recv_batch()
+  struct ReceivedDatagram
+  {
+    Address::Raw source {};        //!< Address of the sender (see source_address())
+    socklen_t source_size {};      //!< Size of the sender's address
+    std::string payload {};        //!< Storage the datagram is read into; only its first `length` bytes are it
+    size_t length {};              //!< Length of the datagram received (see contents())
+    uint16_t gro_segment_size {};  //!< If nonzero, the contents are coalesced datagrams of this size (UDP_GRO)
+    bool truncated {};             //!< The datagram did not fit: the contents are only its first bytes
+
+    Address source_address() const { return { source, source_size }; }
+    std::string_view contents() const { return { payload.data(), length }; }
+  };
+
   //! Receive a datagram and the Address of its sender
   void recv( Address& source_address, std::string& payload );
 
+  //! \brief Receive up to `datagrams.size()` datagrams with one [recvmmsg(2)](\ref man2::recvmmsg)
+  //! \details Each payload is grown to its capacity (at least 16 KiB) on first use and then left at that size,
+  //! so a caller that keeps the vector around receives in steady state without allocating or clearing memory.
+  //! A datagram too big for its payload is cut short and marked `truncated`, and the rest of the batch is still
+  //! returned.
+  //! \returns the number of datagrams received (the first N entries of `datagrams` are filled in)
+  size_t recv_batch( std::vector<ReceivedDatagram>& datagrams );
+
   //! Send a datagram to specified Address
   void sendto( const Address& destination, std::string_view payload );
 
+  //! Send several datagrams to the same Address; returns the number sent
+  size_t sendto_batch( const Address& destination, const std::vector<std::string_view>& payloads );
+
   //! Send datagram to the socket's connected address (must call connect() first)
   void send( std::string_view payload );
+
+  //! Send several datagrams to the socket's connected address; returns the number sent
+  size_t send_batch( const std::vector<std::string_view>& payloads );
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
@@ -82,6 +115,14 @@ class UDPSocket : public DatagramSocket
 public:
   //! Default: construct an unbound, unconnected UDP socket
   UDPSocket() : DatagramSocket( AF_INET, SOCK_DGRAM ) {}
+
+  //! Have the kernel split each sent payload into `segment_size`-byte datagrams ([UDP_SEGMENT](\ref man7::udp))
+  //! \note A segment size of zero turns segmentation offload back off
+  void set_gso_segment_size( uint16_t segment_size );
+
+  //! Allow the kernel to coalesce received datagrams ([UDP_GRO](\ref man7::udp))
+  //! \note Coalesced reads can be up to 64 KiB, so reserve() that much in each ReceivedDatagram::payload
+  void set_gro( bool enabled );
 };
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
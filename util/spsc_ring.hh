@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// A bounded, lock-free queue between exactly one producer thread and one consumer thread.
+//
+// The producer owns `tail_` and the consumer owns `head_`; each only reads the other's
+// index (with acquire ordering, pairing with the owner's release store) to see how far it
+// may go. The two indices live on separate cache lines so the threads do not contend.
+template<class T>
+class SPSCRing
+{
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::vector<T> slots_;
+  size_t mask_;
+  alignas( CACHE_LINE ) std::atomic<size_t> head_ { 0 }; // next slot to pop
+  alignas( CACHE_LINE ) std::atomic<size_t> tail_ { 0 }; // next slot to push
+
+  static size_t round_up( size_t n )
+  {
+    size_t capacity = 1;
+    while ( capacity < n ) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+public:
+  // A ring holding at least `capacity` items (rounded up to a power of two)
+  explicit SPSCRing( const size_t capacity ) : slots_( round_up( capacity ) ), mask_( slots_.size() - 1 ) {}
+
+  // Producer: append an item; returns false (leaving `item` untouched) if the ring is full
+  bool push( T&& item )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - head_.load( std::memory_order_acquire ) == slots_.size() ) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move( item );
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Consumer: remove the oldest item, if any
+  std::optional<T> pop()
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head == tail_.load( std::memory_order_acquire ) ) {
+      return {};
+    }
+    std::optional<T> item { std::move( slots_[head & mask_] ) };
+    head_.store( head + 1, std::memory_order_release );
+    return item;
+  }
+
+  size_t capacity() const { return slots_.size(); }
+};